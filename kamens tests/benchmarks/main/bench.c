@@ -0,0 +1,147 @@
+/* ======================= BENCHMARK RUNNER ======================= */
+/*
+ * See bench.h. Samples go into one static buffer, so nothing here
+ * allocates and a benchmark never measures the heap by accident.
+ */
+
+#include "bench.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
+#include "esp_cpu.h"
+#endif
+
+static const char *TAG = "bench";
+
+#define WARMUP_CALLS 3
+
+typedef struct
+{
+    const char *component;
+    const char *name;
+    uint32_t iterations;
+    uint32_t min;
+    uint32_t median;
+    uint32_t p99;
+} bench_result_t;
+
+static uint32_t s_samples[BENCH_MAX_SAMPLES];
+static bench_result_t s_results[BENCH_MAX_RESULTS];
+static size_t s_result_count;
+static uint32_t s_overhead;
+
+#if CONFIG_IDF_TARGET_LINUX
+#define BENCH_UNIT "ns"
+static inline uint32_t bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+#else
+#define BENCH_UNIT "cycles"
+static inline uint32_t bench_now(void)
+{
+    return esp_cpu_get_cycle_count();
+}
+#endif
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+void bench_calibrate(void)
+{
+    /* Cheapest back-to-back read is the fixed cost every sample includes. */
+    uint32_t best = UINT32_MAX;
+    for (int i = 0; i < 100; i++)
+    {
+        uint32_t start = bench_now();
+        uint32_t end = bench_now();
+        if (end - start < best)
+        {
+            best = end - start;
+        }
+    }
+    s_overhead = best;
+    ESP_LOGI(TAG, "Timer overhead: %" PRIu32 " " BENCH_UNIT, s_overhead);
+}
+
+void bench_run(const char *component, const char *name, uint32_t iterations, bench_fn_t fn, void *arg)
+{
+    if (s_result_count >= BENCH_MAX_RESULTS)
+    {
+        ESP_LOGE(TAG, "Too many results, skipping %s", name);
+        return;
+    }
+    if (iterations == 0 || iterations > BENCH_MAX_SAMPLES)
+    {
+        iterations = BENCH_MAX_SAMPLES;
+    }
+
+    for (int i = 0; i < WARMUP_CALLS; i++)
+    {
+        fn(arg);
+    }
+
+    for (uint32_t i = 0; i < iterations; i++)
+    {
+        uint32_t start = bench_now();
+        fn(arg);
+        uint32_t elapsed = bench_now() - start;
+        s_samples[i] = elapsed > s_overhead ? elapsed - s_overhead : 0;
+    }
+
+    qsort(s_samples, iterations, sizeof(s_samples[0]), compare_u32);
+
+    /* Nearest-rank percentiles */
+    bench_result_t *r = &s_results[s_result_count++];
+    r->component = component;
+    r->name = name;
+    r->iterations = iterations;
+    r->min = s_samples[0];
+    r->median = s_samples[(iterations - 1) / 2];
+    r->p99 = s_samples[(iterations * 99 + 99) / 100 - 1];
+
+    ESP_LOGI(TAG, "%-20s %-36s min %8" PRIu32 "  median %8" PRIu32 "  p99 %8" PRIu32 " " BENCH_UNIT,
+             component, name, r->min, r->median, r->p99);
+}
+
+void bench_print_json(void)
+{
+    /* One printf per piece would let other tasks' log lines land in the middle, so build the line first. */
+    static char line[BENCH_MAX_RESULTS * 160 + 256];
+    size_t len = 0;
+
+    len += snprintf(line + len, sizeof(line) - len,
+                    "{\"target\":\"%s\",\"unit\":\"" BENCH_UNIT "\"", CONFIG_IDF_TARGET);
+#if !CONFIG_IDF_TARGET_LINUX
+    len += snprintf(line + len, sizeof(line) - len, ",\"cpu_mhz\":%d", CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+#endif
+    len += snprintf(line + len, sizeof(line) - len, ",\"results\":[");
+    for (size_t i = 0; i < s_result_count && len < sizeof(line); i++)
+    {
+        const bench_result_t *r = &s_results[i];
+        len += snprintf(line + len, sizeof(line) - len,
+                        "%s{\"component\":\"%s\",\"name\":\"%s\",\"iterations\":%" PRIu32
+                        ",\"min\":%" PRIu32 ",\"median\":%" PRIu32 ",\"p99\":%" PRIu32 "}",
+                        i ? "," : "", r->component, r->name, r->iterations, r->min, r->median, r->p99);
+    }
+    if (len < sizeof(line))
+    {
+        snprintf(line + len, sizeof(line) - len, "]}");
+    }
+
+    printf("BENCH_JSON: %s\n", line);
+    fflush(stdout);
+}
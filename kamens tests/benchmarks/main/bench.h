@@ -0,0 +1,30 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ======================= BENCHMARK RUNNER HEADER ======================= */
+/*
+ * Times one function call at a time and keeps min / median / p99.
+ *
+ * On the chips the unit is CPU cycles (esp_cpu_get_cycle_count()), on the
+ * linux target it is nanoseconds. The cost of reading the counter itself
+ * is measured once by bench_calibrate() and subtracted from every sample.
+ */
+
+#define BENCH_MAX_SAMPLES 1000
+#define BENCH_MAX_RESULTS 32
+
+typedef void (*bench_fn_t)(void *arg);
+
+/* Measure the counter overhead. Call once before bench_run(). */
+void bench_calibrate(void);
+
+/*
+ * Call fn(arg) a few times to warm the caches, then `iterations` more times
+ * (at most BENCH_MAX_SAMPLES), timing each call on its own.
+ */
+void bench_run(const char *component, const char *name, uint32_t iterations, bench_fn_t fn, void *arg);
+
+/* Print every result as one line: "BENCH_JSON: {...}". tools/bench_diff.py reads it. */
+void bench_print_json(void);
@@ -0,0 +1,330 @@
+/**
+ * @file bench_main.c
+ * @brief Component microbenchmarks
+ *
+ * Times the hot entry points of each component one call at a time and
+ * prints a JSON summary. Compare two runs with tools/bench_diff.py.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+
+#include "LED_Controler.h"
+#include "Storage_Manager.h"
+#include "storage_lz.h"
+#include "WEB_Server.h"
+#include "BLE_Utils.h"
+#include "Executor.h"
+
+#include "bench.h"
+#include "mock_httpd.h"
+
+static const char *TAG = "bench_main";
+
+/* NVS writes wear the flash, so those get fewer iterations. */
+#define FAST_ITERATIONS 1000
+#define FLASH_ITERATIONS 200
+#define INLINE_FLASH_ITERATIONS 50
+#define LOG_ITERATIONS 20
+
+/* Let background flash writes from the previous benchmark finish first. */
+static void settle(void)
+{
+    vTaskDelay(pdMS_TO_TICKS(200));
+}
+
+/* ========== LED_Controler ========== */
+
+static void bench_led_set(void *arg)
+{
+    uint32_t *count = arg;
+    led_control_set((int)(++*count & 1));
+}
+
+/* ========== Storage_Manager ========== */
+
+static void bench_storage_get(void *arg)
+{
+    (void)arg;
+    char value[STORAGE_STRING_MAX_LEN];
+    storage_manager_get_string(value, sizeof(value));
+    volatile char first = value[0];
+    (void)first;
+}
+
+static void bench_storage_save(void *arg)
+{
+    /* Alternate, so NVS really has something new to write each time. */
+    uint32_t *count = arg;
+    storage_manager_save_string((++*count & 1) ? "bench-a" : "bench-b");
+}
+
+/* A config document like the ones stored with storage_manager_set_value(). */
+static char s_config_json[1536];
+static size_t s_config_len;
+
+static void make_config_json(void)
+{
+    s_config_len = (size_t)snprintf(s_config_json, sizeof(s_config_json),
+                                    "{\"device\":{\"name\":\"ESP-SKYNET\",\"led_gpio\":2},"
+                                    "\"wifi\":{\"ssid\":\"workshop-2g\",\"retries\":5},\"schedule\":[");
+    for (int i = 0; i < 16 && s_config_len < sizeof(s_config_json) - 96; i++)
+    {
+        s_config_len += (size_t)snprintf(&s_config_json[s_config_len], sizeof(s_config_json) - s_config_len,
+                                         "{\"id\":%d,\"enabled\":%s,\"time\":\"%02d:%02d\",\"action\":\"led_set\"},",
+                                         i, (i % 3) ? "true" : "false", 6 + i, (i * 7) % 60);
+    }
+    s_config_len += (size_t)snprintf(&s_config_json[s_config_len], sizeof(s_config_json) - s_config_len, "{}]}");
+}
+
+static uint8_t s_lz_packed[sizeof(s_config_json)];
+static uint8_t s_lz_unpacked[sizeof(s_config_json)];
+static size_t s_lz_packed_len;
+
+static void bench_lz_compress(void *arg)
+{
+    (void)arg;
+    storage_lz_compress((const uint8_t *)s_config_json, s_config_len, s_lz_packed, sizeof(s_lz_packed));
+}
+
+static void bench_lz_decompress(void *arg)
+{
+    (void)arg;
+    storage_lz_decompress(s_lz_packed, s_lz_packed_len, s_lz_unpacked, sizeof(s_lz_unpacked));
+}
+
+static void bench_value_set(void *arg)
+{
+    const uint32_t *flags = arg;
+    storage_manager_set_value("bench_cfg", s_config_json, s_config_len, *flags);
+}
+
+static void bench_value_get(void *arg)
+{
+    (void)arg;
+    size_t len;
+    storage_manager_get_value("bench_cfg", s_lz_unpacked, sizeof(s_lz_unpacked), &len);
+}
+
+/* NVS entries (32 bytes each, 126 per page) one more value of this kind takes. */
+static size_t nvs_entries_for(const char *key, uint32_t flags)
+{
+    nvs_stats_t before, after;
+    nvs_get_stats(NULL, &before);
+    storage_manager_set_value(key, s_config_json, s_config_len, flags);
+    nvs_get_stats(NULL, &after);
+    storage_manager_delete_value(key);
+    return after.used_entries - before.used_entries;
+}
+
+static void bench_storage_compression(void)
+{
+    make_config_json();
+    s_lz_packed_len = storage_lz_compress((const uint8_t *)s_config_json, s_config_len, s_lz_packed,
+                                          sizeof(s_lz_packed));
+    size_t len = storage_lz_decompress(s_lz_packed, s_lz_packed_len, s_lz_unpacked, sizeof(s_lz_unpacked));
+    if (s_lz_packed_len == 0 || len != s_config_len || memcmp(s_lz_unpacked, s_config_json, len) != 0)
+    {
+        ESP_LOGE(TAG, "BENCH FAIL: storage_lz round trip");
+        return;
+    }
+
+    bench_run("Storage_Manager", "storage_lz_compress config json", FAST_ITERATIONS, bench_lz_compress, NULL);
+    bench_run("Storage_Manager", "storage_lz_decompress config json", FAST_ITERATIONS, bench_lz_decompress, NULL);
+
+    static const uint32_t raw = 0;
+    static const uint32_t compress = STORAGE_VALUE_COMPRESS;
+    settle();
+    bench_run("Storage_Manager", "storage_manager_set_value raw", INLINE_FLASH_ITERATIONS, bench_value_set,
+              (void *)&raw);
+    bench_run("Storage_Manager", "storage_manager_set_value compressed", INLINE_FLASH_ITERATIONS, bench_value_set,
+              (void *)&compress);
+    bench_run("Storage_Manager", "storage_manager_get_value compressed", FAST_ITERATIONS, bench_value_get, NULL);
+    storage_manager_delete_value("bench_cfg");
+
+    /* Bytes feed the per-KB numbers in pytest_benchmarks.py; entries are the flash actually used. */
+    ESP_LOGW(TAG, "STORAGE_LZ_JSON: {\"bytes\": %u, \"compressed_bytes\": %u, \"nvs_entries_raw\": %u, "
+             "\"nvs_entries_compressed\": %u}",
+             (unsigned)s_config_len, (unsigned)s_lz_packed_len,
+             (unsigned)nvs_entries_for("bench_raw", 0), (unsigned)nvs_entries_for("bench_lz", STORAGE_VALUE_COMPRESS));
+}
+
+/* ========== WEB_Server ========== */
+
+typedef struct
+{
+    const char *name;
+    httpd_method_t method;
+    const char *route; /* .uri of the table entry to use */
+    const char *uri;   /* what the client asked for */
+    const char *body;
+    const char *content_type;
+    const char *accept;
+    int expect_error;  /* httpd_err_code_t, or -1 for a normal response */
+    uint32_t iterations;
+} http_case_t;
+
+static const http_case_t s_http_cases[] = {
+    {"GET /", HTTP_GET, "/", "/", NULL, NULL, NULL, -1, FAST_ITERATIONS},
+    {"GET /led?state=on", HTTP_GET, "/led", "/led?state=on", NULL, NULL, NULL, -1, FAST_ITERATIONS},
+    {"GET /string", HTTP_GET, "/string", "/string", NULL, NULL, NULL, -1, FAST_ITERATIONS},
+    {"POST /string form", HTTP_POST, "/string", "/string", "value=bench",
+     "application/x-www-form-urlencoded", NULL, -1, FLASH_ITERATIONS},
+    {"POST /string json", HTTP_POST, "/string", "/string", "{\"value\":\"bench\"}",
+     "application/json", NULL, -1, FLASH_ITERATIONS},
+    {"POST /string?delete=1", HTTP_POST, "/string", "/string?delete=1", NULL, NULL, NULL, -1, FLASH_ITERATIONS},
+    {"DELETE /string", HTTP_DELETE, "/string", "/string", NULL, NULL, NULL, -1, FLASH_ITERATIONS},
+    {"GET /api/cmd/telemetry", HTTP_GET, "/api/cmd/*", "/api/cmd/telemetry", NULL, NULL, NULL, -1,
+     FAST_ITERATIONS},
+    {"POST /api/cmd/led_set json", HTTP_POST, "/api/cmd/*", "/api/cmd/led_set", "{\"state\":true}",
+     "application/json", NULL, -1, FAST_ITERATIONS},
+    {"POST /api/cmd/led_set cbor", HTTP_POST, "/api/cmd/*", "/api/cmd/led_set", "\xa1\x65" "state" "\xf5",
+     "application/cbor", "application/cbor", -1, FAST_ITERATIONS},
+    {"GET /api/cmd/unknown", HTTP_GET, "/api/cmd/*", "/api/cmd/unknown", NULL, NULL, NULL, HTTPD_404_NOT_FOUND,
+     FAST_ITERATIONS},
+#if CONFIG_METRICS_HISTORY_ENABLE
+    /* Chunked reply; the sampler is not started here, so this times the framing of an empty history. */
+    {"GET /api/history?last=60", HTTP_GET, "/api/history", "/api/history?last=60", NULL, NULL, NULL, -1,
+     FAST_ITERATIONS},
+#endif
+};
+
+typedef struct
+{
+    httpd_req_t req;
+    mock_httpd_ctx_t ctx;
+    esp_err_t (*handler)(httpd_req_t *req);
+} http_run_t;
+
+static void bench_http_handler(void *arg)
+{
+    http_run_t *run = arg;
+    mock_httpd_req_rewind(&run->req);
+    run->handler(&run->req);
+}
+
+static void bench_web_server(void)
+{
+    static http_run_t run; /* httpd_req_t holds a 512 byte URI, keep it off the stack */
+    size_t route_count;
+    const httpd_uri_t *routes = web_server_get_uri_handlers(&route_count);
+
+    for (size_t i = 0; i < sizeof(s_http_cases) / sizeof(s_http_cases[0]); i++)
+    {
+        const http_case_t *c = &s_http_cases[i];
+
+        run.handler = NULL;
+        for (size_t r = 0; r < route_count; r++)
+        {
+            if (routes[r].method == c->method && strcmp(routes[r].uri, c->route) == 0)
+            {
+                run.handler = routes[r].handler;
+            }
+        }
+        if (run.handler == NULL)
+        {
+            ESP_LOGE(TAG, "BENCH FAIL: no handler for %s", c->name);
+            continue;
+        }
+
+        /* Check the handler really takes the path we mean to time. */
+        mock_httpd_req_init(&run.req, &run.ctx, c->method, c->uri, c->body, c->content_type, c->accept);
+        run.handler(&run.req);
+        if (run.ctx.responses != 1 || run.ctx.error != c->expect_error)
+        {
+            ESP_LOGE(TAG, "BENCH FAIL: %s answered %d times, error %d (expected %d)",
+                     c->name, run.ctx.responses, run.ctx.error, c->expect_error);
+            continue;
+        }
+
+        settle();
+        bench_run("WEB_Server", c->name, c->iterations, bench_http_handler, &run);
+    }
+}
+
+/* ========== BLE_Utils ========== */
+
+static const ble_utils_conn_info_t s_ble_conn = {
+    .addr = {0x66, 0x55, 0x44, 0x33, 0x22, 0x11},
+    .addr_type = 1,
+    .conn_handle = 1,
+    .conn_itvl = 24,
+    .conn_latency = 0,
+    .supervision_timeout = 500,
+};
+
+static void bench_ble_addr_to_string(void *arg)
+{
+    (void)arg;
+    char addr_str[BLE_UTILS_ADDR_STR_LEN];
+    ble_utils_addr_to_string(s_ble_conn.addr, addr_str, sizeof(addr_str));
+}
+
+static void bench_ble_addr_type(void *arg)
+{
+    uint32_t *count = arg;
+    volatile const char *name = ble_utils_addr_type_to_string((uint8_t)(++*count & 3));
+    (void)name;
+}
+
+static void bench_ble_log_connection(void *arg)
+{
+    (void)arg;
+    ble_utils_log_connection(&s_ble_conn);
+}
+
+void app_main(void)
+{
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND)
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    ESP_ERROR_CHECK(ret);
+
+    led_control_init();
+    storage_manager_init();
+
+    /* Time the components, not the UART: only warnings and errors while measuring. */
+    esp_log_level_set("*", ESP_LOG_WARN);
+    esp_log_level_set("bench", ESP_LOG_INFO);
+
+    bench_calibrate();
+    uint32_t count = 0;
+
+    bench_run("LED_Controler", "led_control_set", FAST_ITERATIONS, bench_led_set, &count);
+    bench_run("Storage_Manager", "storage_manager_get_string", FAST_ITERATIONS, bench_storage_get, NULL);
+
+    /* Before the executor runs, a save does the NVS write itself. */
+    bench_run("Storage_Manager", "storage_manager_save_string inline", INLINE_FLASH_ITERATIONS,
+              bench_storage_save, &count);
+
+    ESP_ERROR_CHECK(executor_start());
+    settle();
+    bench_run("Storage_Manager", "storage_manager_save_string", FLASH_ITERATIONS, bench_storage_save, &count);
+    bench_storage_compression();
+
+    bench_web_server();
+
+    bench_run("BLE_Utils", "ble_utils_addr_to_string", FAST_ITERATIONS, bench_ble_addr_to_string, NULL);
+    bench_run("BLE_Utils", "ble_utils_addr_type_to_string", FAST_ITERATIONS, bench_ble_addr_type, &count);
+
+    /* This one is all UART output, so it gets its log lines back. */
+    esp_log_level_set("ble_peripheral", ESP_LOG_INFO);
+    bench_run("BLE_Utils", "ble_utils_log_connection", LOG_ITERATIONS, bench_ble_log_connection, NULL);
+    esp_log_level_set("ble_peripheral", ESP_LOG_WARN);
+
+    settle();
+    bench_print_json();
+    ESP_LOGW(TAG, "Benchmarks done");
+}
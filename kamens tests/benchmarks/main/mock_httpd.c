@@ -0,0 +1,129 @@
+/* ======================= MOCK HTTP REQUEST ======================= */
+/*
+ * --wrap replacements for the esp_http_server calls made by WEB_Server.c.
+ * See mock_httpd.h.
+ */
+
+#include "mock_httpd.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+void mock_httpd_req_init(httpd_req_t *req, mock_httpd_ctx_t *ctx, httpd_method_t method, const char *uri,
+                         const char *body, const char *content_type, const char *accept)
+{
+    memset(req, 0, sizeof(*req));
+    memset(ctx, 0, sizeof(*ctx));
+
+    req->method = method;
+    snprintf((char *)req->uri, sizeof(req->uri), "%s", uri); /* const for handlers only */
+    req->aux = ctx;
+
+    ctx->body = body ? body : "";
+    ctx->body_len = strlen(ctx->body);
+    ctx->content_type = content_type;
+    ctx->accept = accept;
+    req->content_len = ctx->body_len;
+
+    mock_httpd_req_rewind(req);
+}
+
+void mock_httpd_req_rewind(httpd_req_t *req)
+{
+    mock_httpd_ctx_t *ctx = req->aux;
+    ctx->body_pos = 0;
+    ctx->responses = 0;
+    ctx->chunks = 0;
+    ctx->error = -1;
+    ctx->response_len = 0;
+}
+
+/* Copy src into buf like httpd does: truncate and say so if it does not fit. */
+static esp_err_t copy_out(const char *src, char *buf, size_t buf_len)
+{
+    if (buf_len == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    snprintf(buf, buf_len, "%s", src);
+    return strlen(src) < buf_len ? ESP_OK : ESP_ERR_HTTPD_RESULT_TRUNC;
+}
+
+esp_err_t __wrap_httpd_req_get_url_query_str(httpd_req_t *req, char *buf, size_t buf_len)
+{
+    const char *query = strchr(req->uri, '?');
+    if (query == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return copy_out(query + 1, buf, buf_len);
+}
+
+esp_err_t __wrap_httpd_req_get_hdr_value_str(httpd_req_t *req, const char *field, char *val, size_t val_size)
+{
+    mock_httpd_ctx_t *ctx = req->aux;
+    const char *value = NULL;
+    if (strcasecmp(field, "Content-Type") == 0)
+    {
+        value = ctx->content_type;
+    }
+    else if (strcasecmp(field, "Accept") == 0)
+    {
+        value = ctx->accept;
+    }
+    if (value == NULL)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return copy_out(value, val, val_size);
+}
+
+int __wrap_httpd_req_recv(httpd_req_t *req, char *buf, size_t buf_len)
+{
+    mock_httpd_ctx_t *ctx = req->aux;
+    size_t left = ctx->body_len - ctx->body_pos;
+    size_t n = left < buf_len ? left : buf_len;
+    memcpy(buf, ctx->body + ctx->body_pos, n);
+    ctx->body_pos += n;
+    return (int)n;
+}
+
+esp_err_t __wrap_httpd_resp_set_type(httpd_req_t *req, const char *type)
+{
+    (void)req;
+    (void)type;
+    return ESP_OK;
+}
+
+esp_err_t __wrap_httpd_resp_send(httpd_req_t *req, const char *buf, ssize_t buf_len)
+{
+    mock_httpd_ctx_t *ctx = req->aux;
+    ctx->responses++;
+    ctx->response_len = buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)buf_len;
+    return ESP_OK;
+}
+
+/* A chunked reply counts as one response once the empty closing chunk is sent. */
+esp_err_t __wrap_httpd_resp_send_chunk(httpd_req_t *req, const char *buf, ssize_t buf_len)
+{
+    mock_httpd_ctx_t *ctx = req->aux;
+    size_t len = buf == NULL ? 0 : buf_len == HTTPD_RESP_USE_STRLEN ? strlen(buf) : (size_t)buf_len;
+    if (len == 0)
+    {
+        ctx->responses++;
+        return ESP_OK;
+    }
+    ctx->chunks++;
+    ctx->response_len += len;
+    return ESP_OK;
+}
+
+esp_err_t __wrap_httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    mock_httpd_ctx_t *ctx = req->aux;
+    ctx->responses++;
+    ctx->error = (int)error;
+    ctx->response_len = msg ? strlen(msg) : 0;
+    return ESP_OK;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "esp_http_server.h"
+
+/* ======================= MOCK HTTP REQUEST HEADER ======================= */
+/*
+ * Lets the real WEB_Server handlers run without a socket or an httpd task.
+ *
+ * The benchmark's CMakeLists.txt links with -Wl,--wrap for every
+ * esp_http_server call the handlers make (query string, headers, body,
+ * responses); the wrappers read the fake request below instead of a
+ * connection and only remember what would have been sent.
+ */
+
+typedef struct
+{
+    /* Request, set by mock_httpd_req_init() */
+    const char *body;
+    size_t body_len;
+    size_t body_pos;
+    const char *content_type; /* NULL = header not sent */
+    const char *accept;       /* NULL = header not sent */
+
+    /* Response, filled in by the handler */
+    int responses;            /* httpd_resp_send / _send_err calls and finished chunked replies, should end up 1 */
+    int chunks;               /* non-empty httpd_resp_send_chunk calls */
+    int error;                /* httpd_err_code_t that was sent, -1 for a normal response */
+    size_t response_len;
+} mock_httpd_ctx_t;
+
+/*
+ * Set up req as "<method> <uri>" with an optional body and headers.
+ * uri may contain a query string. ctx must outlive req.
+ */
+void mock_httpd_req_init(httpd_req_t *req, mock_httpd_ctx_t *ctx, httpd_method_t method, const char *uri,
+                         const char *body, const char *content_type, const char *accept);
+
+/* Make the same request ready to be handled again (body read from the start, no response yet). */
+void mock_httpd_req_rewind(httpd_req_t *req);
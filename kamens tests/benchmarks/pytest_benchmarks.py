@@ -0,0 +1,58 @@
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+import json
+import os
+import re
+from typing import Callable
+
+import pytest
+from pytest_embedded import Dut
+from pytest_embedded_idf.utils import idf_parametrize
+
+RESULT_PATTERN = re.compile(rb'BENCH FAIL: ([^\r\n]*)|BENCH_JSON: (\{[^\r\n]*\})')
+LZ_PATTERN = re.compile(rb'BENCH FAIL: ([^\r\n]*)|STORAGE_LZ_JSON: (\{[^\r\n]*\})')
+
+
+def _collect(dut: Dut, log_performance: Callable[[str, object], None]) -> None:
+    match = dut.expect(LZ_PATTERN, timeout=180)
+    assert match.group(1) is None, match.group(1).decode()
+    lz = json.loads(match.group(2))
+
+    match = dut.expect(RESULT_PATTERN, timeout=180)
+    assert match.group(1) is None, match.group(1).decode()
+    run = json.loads(match.group(2))
+
+    # Keep the raw run next to the test log; compare two of them with tools/bench_diff.py.
+    with open(os.path.join(dut.logdir, 'bench_results.json'), 'w', encoding='utf-8') as f:
+        json.dump(run, f, indent=2)
+
+    assert run['results'], 'no benchmark results'
+    for result in run['results']:
+        name = re.sub(r'\W+', '_', f"{result['component']}_{result['name']}").strip('_').lower()
+        log_performance(f'bench_{name}_{run["unit"]}', {k: result[k] for k in ('min', 'median', 'p99')})
+
+    # Compressed values: ratio, cost per KB of input and the NVS entries (32 bytes each) a config document takes.
+    medians = {r['name']: r['median'] for r in run['results'] if r['component'] == 'Storage_Manager'}
+    log_performance('storage_lz_ratio', round(lz['bytes'] / lz['compressed_bytes'], 2))
+    for op in ('compress', 'decompress'):
+        per_kb = medians[f'storage_lz_{op} config json'] * 1024 // lz['bytes']
+        log_performance(f'storage_lz_{op}_{run["unit"]}_per_kb', per_kb)
+    log_performance('storage_nvs_entries', {k: lz[f'nvs_entries_{k}'] for k in ('raw', 'compressed')})
+
+
+@pytest.mark.generic
+@idf_parametrize('target', ['esp32'], indirect=['target'])
+def test_component_benchmarks(dut: Dut, log_performance: Callable[[str, object], None]) -> None:
+    _collect(dut, log_performance)
+
+
+@pytest.mark.host_test
+@pytest.mark.qemu
+@idf_parametrize('target', ['esp32'], indirect=['target'])
+def test_component_benchmarks_qemu(dut: Dut, log_performance: Callable[[str, object], None]) -> None:
+    _collect(dut, log_performance)
+
+
+@pytest.mark.host_test
+@idf_parametrize('target', ['linux'], indirect=['target'])
+def test_component_benchmarks_linux(dut: Dut, log_performance: Callable[[str, object], None]) -> None:
+    _collect(dut, log_performance)
@@ -10,6 +10,7 @@
 
 #include <string.h>
 #include <inttypes.h>
+#include <stdatomic.h>
 
 #include "esp_log.h"
 #include "esp_bt.h"
@@ -22,6 +23,9 @@
 #include "services/gap/ble_svc_gap.h"
 #include "services/gatt/ble_svc_gatt.h"
 
+#include "BLE_Utils.h"
+#include "Executor.h"
+
 static const char *TAG = "ble_peripheral";
 
 /* Device name */
@@ -32,6 +36,10 @@ static uint16_t s_conn_handle = BLE_HS_CONN_HANDLE_NONE;
 static bool s_is_connected = false;
 static uint8_t s_own_addr_type;
 
+/* Copy of the last connection, logged later on the executor instead of in the NimBLE host task */
+static struct ble_gap_conn_desc s_log_desc;
+static atomic_bool s_log_desc_busy = false;
+
 /* Forward declarations */
 static void ble_peripheral_on_sync(void);
 static void ble_peripheral_on_reset(int reason);
@@ -39,45 +47,46 @@ static int ble_peripheral_gap_event(struct ble_gap_event *event, void *arg);
 static void ble_host_task(void *param);
 
 /**
- * @brief Convert BLE address to string
+ * @brief Print connected device details
  */
-static void addr_to_string(const uint8_t *addr, char *str, size_t str_len)
+static void print_connection_info(const struct ble_gap_conn_desc *desc)
 {
-    snprintf(str, str_len, "%02X:%02X:%02X:%02X:%02X:%02X",
-             addr[5], addr[4], addr[3], addr[2], addr[1], addr[0]);
+    ble_utils_conn_info_t info = {
+        .addr_type = desc->peer_id_addr.type,
+        .conn_handle = desc->conn_handle,
+        .conn_itvl = desc->conn_itvl,
+        .conn_latency = desc->conn_latency,
+        .supervision_timeout = desc->supervision_timeout,
+    };
+    memcpy(info.addr, desc->peer_id_addr.val, sizeof(info.addr));
+    ble_utils_log_connection(&info);
 }
 
 /**
- * @brief Get human-readable address type
+ * @brief Executor job: print the saved connection details
  */
-static const char *addr_type_to_string(uint8_t addr_type)
+static int print_connection_info_job(void *arg)
 {
-    switch (addr_type) {
-        case BLE_ADDR_PUBLIC:       return "Public";
-        case BLE_ADDR_RANDOM:       return "Random";
-        case BLE_ADDR_PUBLIC_ID:    return "Public ID";
-        case BLE_ADDR_RANDOM_ID:    return "Random ID";
-        default:                    return "Unknown";
-    }
+    print_connection_info(arg);
+    atomic_store(&s_log_desc_busy, false);
+    return 0;
 }
 
 /**
- * @brief Print connected device details
+ * @brief Log connection details without holding up the NimBLE host task
  */
-static void print_connection_info(const struct ble_gap_conn_desc *desc)
+static void log_connection_info(const struct ble_gap_conn_desc *desc)
 {
-    char addr_str[18];
-    addr_to_string(desc->peer_id_addr.val, addr_str, sizeof(addr_str));
-    
-    ESP_LOGI(TAG, "========================================");
-    ESP_LOGI(TAG, "CONNECTION SUCCESSFUL!");
-    ESP_LOGI(TAG, "========================================");
-    ESP_LOGI(TAG, "  Device Address: %s (%s)", addr_str, addr_type_to_string(desc->peer_id_addr.type));
-    ESP_LOGI(TAG, "  Connection Handle: %u", desc->conn_handle);
-    ESP_LOGI(TAG, "  Connection Interval: %.2f ms", desc->conn_itvl * 1.25f);
-    ESP_LOGI(TAG, "  Slave Latency: %u", desc->conn_latency);
-    ESP_LOGI(TAG, "  Supervision Timeout: %u ms", desc->supervision_timeout * 10);
-    ESP_LOGI(TAG, "========================================");
+    if (atomic_exchange(&s_log_desc_busy, true)) {
+        /* Previous log still pending, just print this one here */
+        print_connection_info(desc);
+        return;
+    }
+
+    s_log_desc = *desc;
+    if (executor_submit(EXECUTOR_PRIO_LOW, print_connection_info_job, &s_log_desc, NULL, NULL) != ESP_OK) {
+        print_connection_info_job(&s_log_desc);
+    }
 }
 
 /**
@@ -144,7 +153,7 @@ static int ble_peripheral_gap_event(struct ble_gap_event *event, void *arg)
             
             struct ble_gap_conn_desc desc;
             if (ble_gap_conn_find(event->connect.conn_handle, &desc) == 0) {
-                print_connection_info(&desc);
+                log_connection_info(&desc);
             }
         } else {
             /* Connection failed */
@@ -158,8 +167,8 @@ static int ble_peripheral_gap_event(struct ble_gap_event *event, void *arg)
     }
     
     case BLE_GAP_EVENT_DISCONNECT: {
-        char addr_str[18];
-        addr_to_string(event->disconnect.conn.peer_id_addr.val, addr_str, sizeof(addr_str));
+        char addr_str[BLE_UTILS_ADDR_STR_LEN];
+        ble_utils_addr_to_string(event->disconnect.conn.peer_id_addr.val, addr_str, sizeof(addr_str));
         
         ESP_LOGI(TAG, "Device disconnected: %s (reason=0x%02x)", 
                  addr_str, event->disconnect.reason);
@@ -218,8 +227,8 @@ static void ble_peripheral_on_sync(void)
     uint8_t addr[6];
     rc = ble_hs_id_copy_addr(s_own_addr_type, addr, NULL);
     if (rc == 0) {
-        char addr_str[18];
-        addr_to_string(addr, addr_str, sizeof(addr_str));
+        char addr_str[BLE_UTILS_ADDR_STR_LEN];
+        ble_utils_addr_to_string(addr, addr_str, sizeof(addr_str));
         ESP_LOGI(TAG, "BLE Peripheral initialized. Our address: %s", addr_str);
     }
     
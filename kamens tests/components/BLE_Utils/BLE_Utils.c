@@ -0,0 +1,51 @@
+/**
+ * @file BLE_Utils.c
+ * @brief Formatting and logging helpers for BLE connections
+ */
+
+#include "BLE_Utils.h"
+
+#include <stdio.h>
+
+#include "esp_log.h"
+
+static const char *TAG = "ble_peripheral";
+
+/* Same values as NimBLE's BLE_ADDR_* constants */
+#define ADDR_TYPE_PUBLIC    0
+#define ADDR_TYPE_RANDOM    1
+#define ADDR_TYPE_PUBLIC_ID 2
+#define ADDR_TYPE_RANDOM_ID 3
+
+void ble_utils_addr_to_string(const uint8_t *addr, char *str, size_t str_len)
+{
+    snprintf(str, str_len, "%02X:%02X:%02X:%02X:%02X:%02X",
+             addr[5], addr[4], addr[3], addr[2], addr[1], addr[0]);
+}
+
+const char *ble_utils_addr_type_to_string(uint8_t addr_type)
+{
+    switch (addr_type) {
+        case ADDR_TYPE_PUBLIC:       return "Public";
+        case ADDR_TYPE_RANDOM:       return "Random";
+        case ADDR_TYPE_PUBLIC_ID:    return "Public ID";
+        case ADDR_TYPE_RANDOM_ID:    return "Random ID";
+        default:                     return "Unknown";
+    }
+}
+
+void ble_utils_log_connection(const ble_utils_conn_info_t *info)
+{
+    char addr_str[BLE_UTILS_ADDR_STR_LEN];
+    ble_utils_addr_to_string(info->addr, addr_str, sizeof(addr_str));
+    
+    ESP_LOGI(TAG, "========================================");
+    ESP_LOGI(TAG, "CONNECTION SUCCESSFUL!");
+    ESP_LOGI(TAG, "========================================");
+    ESP_LOGI(TAG, "  Device Address: %s (%s)", addr_str, ble_utils_addr_type_to_string(info->addr_type));
+    ESP_LOGI(TAG, "  Connection Handle: %u", info->conn_handle);
+    ESP_LOGI(TAG, "  Connection Interval: %.2f ms", info->conn_itvl * 1.25f);
+    ESP_LOGI(TAG, "  Slave Latency: %u", info->conn_latency);
+    ESP_LOGI(TAG, "  Supervision Timeout: %u ms", info->supervision_timeout * 10);
+    ESP_LOGI(TAG, "========================================");
+}
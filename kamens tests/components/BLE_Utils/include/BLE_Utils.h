@@ -0,0 +1,53 @@
+/**
+ * @file BLE_Utils.h
+ * @brief Formatting and logging helpers for BLE connections
+ *
+ * Kept apart from BLE.c so they build without the NimBLE stack
+ * (benchmarks, linux target).
+ */
+
+#ifndef BLE_UTILS_H
+#define BLE_UTILS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Length of "AA:BB:CC:DD:EE:FF" plus the terminating '\0' */
+#define BLE_UTILS_ADDR_STR_LEN 18
+
+/**
+ * @brief Connection details worth logging, copied out of the NimBLE descriptor
+ */
+typedef struct {
+    uint8_t addr[6];           /**< Peer identity address, little endian like NimBLE */
+    uint8_t addr_type;         /**< BLE_ADDR_PUBLIC / RANDOM / PUBLIC_ID / RANDOM_ID */
+    uint16_t conn_handle;
+    uint16_t conn_itvl;        /**< In units of 1.25 ms */
+    uint16_t conn_latency;
+    uint16_t supervision_timeout; /**< In units of 10 ms */
+} ble_utils_conn_info_t;
+
+/**
+ * @brief Convert BLE address to string ("AA:BB:CC:DD:EE:FF", most significant byte first)
+ */
+void ble_utils_addr_to_string(const uint8_t *addr, char *str, size_t str_len);
+
+/**
+ * @brief Get human-readable address type
+ */
+const char *ble_utils_addr_type_to_string(uint8_t addr_type);
+
+/**
+ * @brief Print connected device details
+ */
+void ble_utils_log_connection(const ble_utils_conn_info_t *info);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLE_UTILS_H */
@@ -0,0 +1,1122 @@
+/* ======================= COMMAND ROUTER ======================= */
+/*
+ * Generic decode -> dispatch -> encode for every command in commands.json.
+ *
+ * The decoders and encoders below know nothing about individual commands.
+ * They walk the generated field tables (name, type, offset, max length)
+ * and read or write the argument / result structs through the offsets.
+ * Adding a command therefore only means editing commands.json and writing
+ * its handler in command_handlers.c.
+ */
+
+#include "Command_Router.h"
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "esp_log.h"
+
+#if CONFIG_COMMAND_ROUTER_BENCHMARK
+#include "esp_cpu.h"
+#endif
+
+static const char *TAG = "cmd_router";
+
+/* Nested JSON / CBOR values under unknown keys are skipped up to this depth. */
+#define SKIP_MAX_DEPTH 4
+
+/* ========== LOOKUP ========== */
+
+/*
+ * Keys come from the wire with an explicit length and may contain a NUL,
+ * so compare lengths first and then bytes; never let strncmp() stop early.
+ */
+static bool name_equals(const char *name, const char *key, size_t key_len)
+{
+    return strlen(name) == key_len && memcmp(name, key, key_len) == 0;
+}
+
+const command_desc_t *command_router_find(uint8_t id)
+{
+    /* The generator guarantees ids are 1..COMMAND_COUNT in table order. */
+    if (id == 0 || id > COMMAND_COUNT || g_command_table[id - 1].handler == NULL)
+    {
+        return NULL; /* handler is NULL for commands switched off in Kconfig */
+    }
+    return &g_command_table[id - 1];
+}
+
+const command_desc_t *command_router_find_by_name(const char *name, size_t name_len)
+{
+    for (size_t i = 0; i < COMMAND_COUNT; i++)
+    {
+        const char *candidate = g_command_table[i].name;
+        if (g_command_table[i].handler != NULL && name_equals(candidate, name, name_len))
+        {
+            return &g_command_table[i];
+        }
+    }
+    return NULL;
+}
+
+static const command_field_t *find_field(const command_field_t *fields, uint8_t count,
+                                         const char *name, size_t name_len, int *index)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (name_equals(fields[i].name, name, name_len))
+        {
+            *index = i;
+            return &fields[i];
+        }
+    }
+    return NULL;
+}
+
+/* ========== FIELD SETTERS ========== */
+
+static void set_bool(const command_field_t *field, void *base, bool value)
+{
+    *(bool *)((uint8_t *)base + field->offset) = value;
+}
+
+static void set_u32(const command_field_t *field, void *base, uint32_t value)
+{
+    *(uint32_t *)((uint8_t *)base + field->offset) = value;
+}
+
+static char *string_dst(const command_field_t *field, void *base)
+{
+    return (char *)base + field->offset;
+}
+
+/* Parse an unsigned decimal number that fits in 32 bits. */
+static bool parse_u32(const char *text, size_t len, uint32_t *out)
+{
+    if (len == 0 || len > 10)
+    {
+        return false;
+    }
+    uint64_t value = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        if (text[i] < '0' || text[i] > '9')
+        {
+            return false;
+        }
+        value = value * 10 + (uint64_t)(text[i] - '0');
+    }
+    if (value > UINT32_MAX)
+    {
+        return false;
+    }
+    *out = (uint32_t)value;
+    return true;
+}
+
+/* Accept the spellings the web UI and scripts use for booleans. */
+static bool parse_bool_text(const char *text, size_t len, bool *out)
+{
+    static const char *const on_words[] = {"on", "1", "true"};
+    static const char *const off_words[] = {"off", "0", "false"};
+    for (size_t i = 0; i < sizeof(on_words) / sizeof(on_words[0]); i++)
+    {
+        if (name_equals(on_words[i], text, len))
+        {
+            *out = true;
+            return true;
+        }
+        if (name_equals(off_words[i], text, len))
+        {
+            *out = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+static command_status_t check_required(const command_desc_t *cmd, uint32_t seen)
+{
+    uint32_t all = cmd->arg_count >= 32 ? UINT32_MAX : ((1u << cmd->arg_count) - 1u);
+    return (seen & all) == all ? COMMAND_OK : COMMAND_ERR_MISSING_FIELD;
+}
+
+/* ========== FORM DECODER ========== */
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+/* URL-decode src into dst (at most dst_max chars, then '\0'). */
+static command_status_t url_decode(const char *src, size_t len, char *dst, size_t dst_max)
+{
+    size_t out = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        char c = src[i];
+        if (c == '+')
+        {
+            c = ' ';
+        }
+        else if (c == '%')
+        {
+            if (i + 2 >= len)
+            {
+                return COMMAND_ERR_SYNTAX;
+            }
+            int hi = hex_value(src[i + 1]);
+            int lo = hex_value(src[i + 2]);
+            if (hi < 0 || lo < 0 || (hi == 0 && lo == 0))
+            {
+                return COMMAND_ERR_BAD_VALUE;
+            }
+            c = (char)(hi << 4 | lo);
+            i += 2;
+        }
+        if (out >= dst_max)
+        {
+            return COMMAND_ERR_TOO_LONG;
+        }
+        dst[out++] = c;
+    }
+    dst[out] = '\0';
+    return COMMAND_OK;
+}
+
+static command_status_t form_store(const command_field_t *field, void *args, const char *value, size_t len)
+{
+    if (field->type == COMMAND_FIELD_STRING)
+    {
+        return url_decode(value, len, string_dst(field, args), field->max_len);
+    }
+
+    char text[12];
+    command_status_t status = url_decode(value, len, text, sizeof(text) - 1);
+    if (status != COMMAND_OK)
+    {
+        return status == COMMAND_ERR_TOO_LONG ? COMMAND_ERR_BAD_VALUE : status;
+    }
+
+    if (field->type == COMMAND_FIELD_BOOL)
+    {
+        bool b;
+        if (!parse_bool_text(text, strlen(text), &b))
+        {
+            return COMMAND_ERR_BAD_VALUE;
+        }
+        set_bool(field, args, b);
+        return COMMAND_OK;
+    }
+
+    uint32_t u;
+    if (!parse_u32(text, strlen(text), &u))
+    {
+        return COMMAND_ERR_BAD_VALUE;
+    }
+    set_u32(field, args, u);
+    return COMMAND_OK;
+}
+
+static command_status_t decode_form(const command_desc_t *cmd, const char *in, size_t len, void *args)
+{
+    uint32_t seen = 0;
+    size_t pos = 0;
+
+    while (pos < len)
+    {
+        const char *pair = in + pos;
+        const char *amp = memchr(pair, '&', len - pos);
+        size_t pair_len = amp ? (size_t)(amp - pair) : len - pos;
+        pos += pair_len + 1;
+
+        const char *eq = memchr(pair, '=', pair_len);
+        size_t key_len = eq ? (size_t)(eq - pair) : pair_len;
+        int index;
+        const command_field_t *field = find_field(cmd->args, cmd->arg_count, pair, key_len, &index);
+        if (field == NULL)
+        {
+            continue; /* unknown keys are fine, e.g. extra query parameters */
+        }
+        if (eq == NULL)
+        {
+            return COMMAND_ERR_BAD_VALUE;
+        }
+
+        command_status_t status = form_store(field, args, eq + 1, pair_len - key_len - 1);
+        if (status != COMMAND_OK)
+        {
+            return status;
+        }
+        seen |= 1u << index;
+    }
+    return check_required(cmd, seen);
+}
+
+/* ========== JSON DECODER ========== */
+
+typedef struct
+{
+    const char *p;
+    const char *end;
+} json_cursor_t;
+
+static void json_ws(json_cursor_t *c)
+{
+    while (c->p < c->end && (*c->p == ' ' || *c->p == '\t' || *c->p == '\n' || *c->p == '\r'))
+    {
+        c->p++;
+    }
+}
+
+static bool json_take(json_cursor_t *c, char ch)
+{
+    json_ws(c);
+    if (c->p < c->end && *c->p == ch)
+    {
+        c->p++;
+        return true;
+    }
+    return false;
+}
+
+/* Find the raw (still escaped) body of a string; the cursor must sit on the opening quote. */
+static bool json_raw_string(json_cursor_t *c, const char **start, size_t *len)
+{
+    if (c->p >= c->end || *c->p != '"')
+    {
+        return false;
+    }
+    const char *s = ++c->p;
+    while (c->p < c->end && *c->p != '"')
+    {
+        if ((unsigned char)*c->p < 0x20)
+        {
+            return false;
+        }
+        c->p += (*c->p == '\\') ? 2 : 1;
+    }
+    if (c->p >= c->end)
+    {
+        return false;
+    }
+    *start = s;
+    *len = (size_t)(c->p - s);
+    c->p++;
+    return true;
+}
+
+/* Unescape a raw JSON string body into dst (at most dst_max bytes, then '\0'). */
+static command_status_t json_unescape(const char *s, size_t len, char *dst, size_t dst_max)
+{
+    size_t out = 0;
+    for (size_t i = 0; i < len; i++)
+    {
+        char utf8[3];
+        size_t n = 1;
+        utf8[0] = s[i];
+
+        if (s[i] == '\\')
+        {
+            if (++i >= len)
+            {
+                return COMMAND_ERR_SYNTAX;
+            }
+            switch (s[i])
+            {
+            case '"': utf8[0] = '"'; break;
+            case '\\': utf8[0] = '\\'; break;
+            case '/': utf8[0] = '/'; break;
+            case 'b': utf8[0] = '\b'; break;
+            case 'f': utf8[0] = '\f'; break;
+            case 'n': utf8[0] = '\n'; break;
+            case 'r': utf8[0] = '\r'; break;
+            case 't': utf8[0] = '\t'; break;
+            case 'u':
+            {
+                if (i + 4 >= len)
+                {
+                    return COMMAND_ERR_SYNTAX;
+                }
+                uint32_t cp = 0;
+                for (int k = 1; k <= 4; k++)
+                {
+                    int h = hex_value(s[i + k]);
+                    if (h < 0)
+                    {
+                        return COMMAND_ERR_SYNTAX;
+                    }
+                    cp = cp << 4 | (uint32_t)h;
+                }
+                i += 4;
+                /* No surrogate pairs and no NUL: keeps the stored strings simple. */
+                if (cp == 0 || (cp >= 0xD800 && cp <= 0xDFFF))
+                {
+                    return COMMAND_ERR_BAD_VALUE;
+                }
+                if (cp < 0x80)
+                {
+                    utf8[0] = (char)cp;
+                }
+                else if (cp < 0x800)
+                {
+                    utf8[0] = (char)(0xC0 | cp >> 6);
+                    utf8[1] = (char)(0x80 | (cp & 0x3F));
+                    n = 2;
+                }
+                else
+                {
+                    utf8[0] = (char)(0xE0 | cp >> 12);
+                    utf8[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+                    utf8[2] = (char)(0x80 | (cp & 0x3F));
+                    n = 3;
+                }
+                break;
+            }
+            default:
+                return COMMAND_ERR_SYNTAX;
+            }
+        }
+
+        if (out + n > dst_max)
+        {
+            return COMMAND_ERR_TOO_LONG;
+        }
+        memcpy(dst + out, utf8, n);
+        out += n;
+    }
+    dst[out] = '\0';
+    return COMMAND_OK;
+}
+
+static bool json_literal(json_cursor_t *c, const char *word)
+{
+    size_t n = strlen(word);
+    if ((size_t)(c->end - c->p) >= n && strncmp(c->p, word, n) == 0)
+    {
+        c->p += n;
+        return true;
+    }
+    return false;
+}
+
+static bool json_number(json_cursor_t *c, const char **start, size_t *len)
+{
+    const char *s = c->p;
+    while (c->p < c->end && *c->p != '\0' && strchr("+-.eE0123456789", *c->p) != NULL)
+    {
+        c->p++;
+    }
+    *start = s;
+    *len = (size_t)(c->p - s);
+    return *len > 0;
+}
+
+/* Skip any JSON value, including nested objects and arrays. */
+static bool json_skip(json_cursor_t *c, int depth)
+{
+    const char *s;
+    size_t n;
+
+    json_ws(c);
+    if (c->p >= c->end || depth > SKIP_MAX_DEPTH)
+    {
+        return false;
+    }
+    if (*c->p == '"')
+    {
+        return json_raw_string(c, &s, &n);
+    }
+    if (*c->p == '{' || *c->p == '[')
+    {
+        char close = (*c->p == '{') ? '}' : ']';
+        bool object = (*c->p == '{');
+        c->p++;
+        if (json_take(c, close))
+        {
+            return true;
+        }
+        do
+        {
+            if (object)
+            {
+                json_ws(c);
+                if (!json_raw_string(c, &s, &n) || !json_take(c, ':'))
+                {
+                    return false;
+                }
+            }
+            if (!json_skip(c, depth + 1))
+            {
+                return false;
+            }
+        } while (json_take(c, ','));
+        return json_take(c, close);
+    }
+    return json_literal(c, "true") || json_literal(c, "false") || json_literal(c, "null") ||
+           json_number(c, &s, &n);
+}
+
+static command_status_t json_store(const command_field_t *field, void *args, json_cursor_t *c)
+{
+    const char *s;
+    size_t n;
+
+    json_ws(c);
+    if (field->type == COMMAND_FIELD_STRING)
+    {
+        if (c->p >= c->end || *c->p != '"')
+        {
+            return COMMAND_ERR_BAD_VALUE;
+        }
+        if (!json_raw_string(c, &s, &n))
+        {
+            return COMMAND_ERR_SYNTAX;
+        }
+        return json_unescape(s, n, string_dst(field, args), field->max_len);
+    }
+
+    if (field->type == COMMAND_FIELD_BOOL)
+    {
+        if (json_literal(c, "true"))
+        {
+            set_bool(field, args, true);
+            return COMMAND_OK;
+        }
+        if (json_literal(c, "false"))
+        {
+            set_bool(field, args, false);
+            return COMMAND_OK;
+        }
+    }
+
+    uint32_t u;
+    if (!json_number(c, &s, &n) || !parse_u32(s, n, &u))
+    {
+        return COMMAND_ERR_BAD_VALUE;
+    }
+    if (field->type == COMMAND_FIELD_BOOL)
+    {
+        if (u > 1)
+        {
+            return COMMAND_ERR_BAD_VALUE;
+        }
+        set_bool(field, args, u == 1);
+    }
+    else
+    {
+        set_u32(field, args, u);
+    }
+    return COMMAND_OK;
+}
+
+static command_status_t decode_json(const command_desc_t *cmd, const char *in, size_t len, void *args)
+{
+    json_cursor_t c = {in, in + len};
+    uint32_t seen = 0;
+
+    if (!json_take(&c, '{'))
+    {
+        return COMMAND_ERR_SYNTAX;
+    }
+    if (!json_take(&c, '}'))
+    {
+        do
+        {
+            const char *key;
+            size_t key_len;
+            json_ws(&c);
+            if (!json_raw_string(&c, &key, &key_len) || !json_take(&c, ':'))
+            {
+                return COMMAND_ERR_SYNTAX;
+            }
+
+            int index;
+            const command_field_t *field = find_field(cmd->args, cmd->arg_count, key, key_len, &index);
+            if (field == NULL)
+            {
+                if (!json_skip(&c, 0))
+                {
+                    return COMMAND_ERR_SYNTAX;
+                }
+                continue;
+            }
+
+            command_status_t status = json_store(field, args, &c);
+            if (status != COMMAND_OK)
+            {
+                return status;
+            }
+            seen |= 1u << index;
+        } while (json_take(&c, ','));
+
+        if (!json_take(&c, '}'))
+        {
+            return COMMAND_ERR_SYNTAX;
+        }
+    }
+
+    json_ws(&c);
+    if (c.p != c.end)
+    {
+        return COMMAND_ERR_SYNTAX;
+    }
+    return check_required(cmd, seen);
+}
+
+/* ========== CBOR DECODER ========== */
+
+typedef struct
+{
+    const uint8_t *p;
+    const uint8_t *end;
+} cbor_cursor_t;
+
+#define CBOR_UINT 0
+#define CBOR_NEGINT 1
+#define CBOR_BYTES 2
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_TAG 6
+#define CBOR_SIMPLE 7
+
+#define CBOR_FALSE 20
+#define CBOR_TRUE 21
+#define CBOR_NULL 22
+
+/* Read one item head. Indefinite lengths and floats are not supported. */
+static bool cbor_head(cbor_cursor_t *c, uint8_t *major, uint32_t *value)
+{
+    if (c->p >= c->end)
+    {
+        return false;
+    }
+    uint8_t ib = *c->p++;
+    uint8_t ai = ib & 0x1F;
+    *major = ib >> 5;
+
+    if (*major == CBOR_SIMPLE && ai >= 24)
+    {
+        return false;
+    }
+    if (ai < 24)
+    {
+        *value = ai;
+        return true;
+    }
+
+    size_t n = (ai == 24) ? 1 : (ai == 25) ? 2 : (ai == 26) ? 4 : 0;
+    if (n == 0 || (size_t)(c->end - c->p) < n)
+    {
+        return false;
+    }
+    uint32_t v = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        v = v << 8 | *c->p++;
+    }
+    *value = v;
+    return true;
+}
+
+static bool cbor_skip(cbor_cursor_t *c, int depth)
+{
+    uint8_t major;
+    uint32_t value;
+
+    if (depth > SKIP_MAX_DEPTH || !cbor_head(c, &major, &value))
+    {
+        return false;
+    }
+    switch (major)
+    {
+    case CBOR_BYTES:
+    case CBOR_TEXT:
+        if ((size_t)(c->end - c->p) < value)
+        {
+            return false;
+        }
+        c->p += value;
+        return true;
+    case CBOR_ARRAY:
+    case CBOR_MAP:
+    {
+        uint32_t items = (major == CBOR_MAP) ? value * 2 : value;
+        for (uint32_t i = 0; i < items; i++)
+        {
+            if (!cbor_skip(c, depth + 1))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    case CBOR_TAG:
+        return cbor_skip(c, depth + 1);
+    default:
+        return true;
+    }
+}
+
+static command_status_t cbor_store(const command_field_t *field, void *args, cbor_cursor_t *c)
+{
+    uint8_t major;
+    uint32_t value;
+
+    if (!cbor_head(c, &major, &value))
+    {
+        return COMMAND_ERR_SYNTAX;
+    }
+
+    switch (field->type)
+    {
+    case COMMAND_FIELD_STRING:
+    {
+        if (major != CBOR_TEXT)
+        {
+            return COMMAND_ERR_BAD_VALUE;
+        }
+        if ((size_t)(c->end - c->p) < value)
+        {
+            return COMMAND_ERR_SYNTAX;
+        }
+        if (value > field->max_len)
+        {
+            return COMMAND_ERR_TOO_LONG;
+        }
+        if (memchr(c->p, '\0', value) != NULL)
+        {
+            return COMMAND_ERR_BAD_VALUE;
+        }
+        char *dst = string_dst(field, args);
+        memcpy(dst, c->p, value);
+        dst[value] = '\0';
+        c->p += value;
+        return COMMAND_OK;
+    }
+
+    case COMMAND_FIELD_BOOL:
+        if (major == CBOR_SIMPLE && (value == CBOR_TRUE || value == CBOR_FALSE))
+        {
+            set_bool(field, args, value == CBOR_TRUE);
+            return COMMAND_OK;
+        }
+        if (major == CBOR_UINT && value <= 1)
+        {
+            set_bool(field, args, value == 1);
+            return COMMAND_OK;
+        }
+        return COMMAND_ERR_BAD_VALUE;
+
+    case COMMAND_FIELD_U32:
+        if (major != CBOR_UINT)
+        {
+            return COMMAND_ERR_BAD_VALUE;
+        }
+        set_u32(field, args, value);
+        return COMMAND_OK;
+    }
+    return COMMAND_ERR_BAD_VALUE;
+}
+
+static command_status_t decode_cbor(const command_desc_t *cmd, const uint8_t *in, size_t len, void *args)
+{
+    cbor_cursor_t c = {in, in + len};
+    uint8_t major;
+    uint32_t pairs;
+    uint32_t seen = 0;
+
+    if (!cbor_head(&c, &major, &pairs) || major != CBOR_MAP)
+    {
+        return COMMAND_ERR_SYNTAX;
+    }
+
+    for (uint32_t i = 0; i < pairs; i++)
+    {
+        uint32_t key_len;
+        if (!cbor_head(&c, &major, &key_len) || major != CBOR_TEXT || (size_t)(c.end - c.p) < key_len)
+        {
+            return COMMAND_ERR_SYNTAX;
+        }
+        const char *key = (const char *)c.p;
+        c.p += key_len;
+
+        int index;
+        const command_field_t *field = find_field(cmd->args, cmd->arg_count, key, key_len, &index);
+        if (field == NULL)
+        {
+            if (!cbor_skip(&c, 0))
+            {
+                return COMMAND_ERR_SYNTAX;
+            }
+            continue;
+        }
+
+        command_status_t status = cbor_store(field, args, &c);
+        if (status != COMMAND_OK)
+        {
+            return status;
+        }
+        seen |= 1u << index;
+    }
+
+    if (c.p != c.end)
+    {
+        return COMMAND_ERR_SYNTAX;
+    }
+    return check_required(cmd, seen);
+}
+
+/* ========== ENCODERS ========== */
+
+typedef struct
+{
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} out_buf_t;
+
+static void out_bytes(out_buf_t *o, const void *data, size_t n)
+{
+    if (o->overflow || o->size - o->len < n)
+    {
+        o->overflow = true;
+        return;
+    }
+    memcpy(o->buf + o->len, data, n);
+    o->len += n;
+}
+
+static void out_str(out_buf_t *o, const char *s)
+{
+    out_bytes(o, s, strlen(s));
+}
+
+static void out_u32_text(out_buf_t *o, uint32_t v)
+{
+    char digits[10];
+    int n = 0;
+    do
+    {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+    while (n > 0)
+    {
+        out_bytes(o, &digits[--n], 1);
+    }
+}
+
+static void out_cbor_head(out_buf_t *o, uint8_t major, uint32_t value)
+{
+    uint8_t head[5];
+    size_t n;
+    if (value < 24)
+    {
+        head[0] = (uint8_t)(major << 5 | value);
+        n = 1;
+    }
+    else if (value <= 0xFF)
+    {
+        head[0] = (uint8_t)(major << 5 | 24);
+        head[1] = (uint8_t)value;
+        n = 2;
+    }
+    else if (value <= 0xFFFF)
+    {
+        head[0] = (uint8_t)(major << 5 | 25);
+        head[1] = (uint8_t)(value >> 8);
+        head[2] = (uint8_t)value;
+        n = 3;
+    }
+    else
+    {
+        head[0] = (uint8_t)(major << 5 | 26);
+        head[1] = (uint8_t)(value >> 24);
+        head[2] = (uint8_t)(value >> 16);
+        head[3] = (uint8_t)(value >> 8);
+        head[4] = (uint8_t)value;
+        n = 5;
+    }
+    out_bytes(o, head, n);
+}
+
+static void out_json_string(out_buf_t *o, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    out_bytes(o, "\"", 1);
+    for (; *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\')
+        {
+            char esc[2] = {'\\', (char)c};
+            out_bytes(o, esc, 2);
+        }
+        else if (c < 0x20)
+        {
+            char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF]};
+            out_bytes(o, esc, 6);
+        }
+        else
+        {
+            out_bytes(o, s, 1);
+        }
+    }
+    out_bytes(o, "\"", 1);
+}
+
+static void out_form_string(out_buf_t *o, const char *s)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    for (; *s; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+            c == '-' || c == '_' || c == '.' || c == '~')
+        {
+            out_bytes(o, s, 1);
+        }
+        else
+        {
+            char esc[3] = {'%', hex[c >> 4], hex[c & 0xF]};
+            out_bytes(o, esc, 3);
+        }
+    }
+}
+
+static void encode_field(out_buf_t *o, command_format_t format, const command_field_t *field, const void *result)
+{
+    const uint8_t *ptr = (const uint8_t *)result + field->offset;
+
+    switch (field->type)
+    {
+    case COMMAND_FIELD_BOOL:
+    {
+        bool b = *(const bool *)ptr;
+        if (format == COMMAND_FORMAT_CBOR)
+            out_cbor_head(o, CBOR_SIMPLE, b ? CBOR_TRUE : CBOR_FALSE);
+        else if (format == COMMAND_FORMAT_JSON)
+            out_str(o, b ? "true" : "false");
+        else
+            out_str(o, b ? "on" : "off");
+        break;
+    }
+    case COMMAND_FIELD_U32:
+    {
+        uint32_t u = *(const uint32_t *)ptr;
+        if (format == COMMAND_FORMAT_CBOR)
+            out_cbor_head(o, CBOR_UINT, u);
+        else
+            out_u32_text(o, u);
+        break;
+    }
+    case COMMAND_FIELD_STRING:
+    {
+        const char *s = (const char *)ptr;
+        if (format == COMMAND_FORMAT_CBOR)
+        {
+            size_t n = strnlen(s, field->max_len);
+            out_cbor_head(o, CBOR_TEXT, (uint32_t)n);
+            out_bytes(o, s, n);
+        }
+        else if (format == COMMAND_FORMAT_JSON)
+            out_json_string(o, s);
+        else
+            out_form_string(o, s);
+        break;
+    }
+    }
+}
+
+/* ========== PUBLIC API ========== */
+
+command_status_t command_router_decode(uint8_t id, command_format_t format,
+                                       const void *in, size_t len, void *args)
+{
+    const command_desc_t *cmd = command_router_find(id);
+    if (cmd == NULL)
+    {
+        return COMMAND_ERR_UNKNOWN;
+    }
+
+    switch (format)
+    {
+    case COMMAND_FORMAT_FORM:
+        return decode_form(cmd, in, len, args);
+    case COMMAND_FORMAT_JSON:
+        return decode_json(cmd, in, len, args);
+    case COMMAND_FORMAT_CBOR:
+        return decode_cbor(cmd, in, len, args);
+    }
+    return COMMAND_ERR_SYNTAX;
+}
+
+command_status_t command_router_dispatch(uint8_t id, const void *args, void *result)
+{
+    const command_desc_t *cmd = command_router_find(id);
+    if (cmd == NULL)
+    {
+        return COMMAND_ERR_UNKNOWN;
+    }
+    return cmd->handler(args, result);
+}
+
+command_status_t command_router_encode(uint8_t id, command_format_t format, const void *result,
+                                       void *out, size_t out_size, size_t *out_len)
+{
+    const command_desc_t *cmd = command_router_find(id);
+    if (cmd == NULL)
+    {
+        return COMMAND_ERR_UNKNOWN;
+    }
+
+    out_buf_t o = {out, out_size, 0, false};
+    if (format == COMMAND_FORMAT_CBOR)
+    {
+        out_cbor_head(&o, CBOR_MAP, cmd->result_count);
+    }
+    else if (format == COMMAND_FORMAT_JSON)
+    {
+        out_str(&o, "{");
+    }
+
+    for (uint8_t i = 0; i < cmd->result_count; i++)
+    {
+        const command_field_t *field = &cmd->result[i];
+        if (format == COMMAND_FORMAT_CBOR)
+        {
+            out_cbor_head(&o, CBOR_TEXT, (uint32_t)strlen(field->name));
+            out_str(&o, field->name);
+        }
+        else
+        {
+            if (i > 0)
+            {
+                out_str(&o, format == COMMAND_FORMAT_JSON ? "," : "&");
+            }
+            if (format == COMMAND_FORMAT_JSON)
+            {
+                out_json_string(&o, field->name);
+                out_str(&o, ":");
+            }
+            else
+            {
+                out_str(&o, field->name);
+                out_str(&o, "=");
+            }
+        }
+        encode_field(&o, format, field, result);
+    }
+
+    if (format == COMMAND_FORMAT_JSON)
+    {
+        out_str(&o, "}");
+    }
+
+    size_t len = o.len;
+    if (format != COMMAND_FORMAT_CBOR)
+    {
+        out_bytes(&o, "", 1); /* '\0' terminator, not counted */
+    }
+    if (o.overflow)
+    {
+        return COMMAND_ERR_NO_SPACE;
+    }
+    *out_len = len;
+    return COMMAND_OK;
+}
+
+command_status_t command_router_execute(uint8_t id, command_format_t in_format, const void *in, size_t in_len,
+                                        command_format_t out_format, void *out, size_t out_size, size_t *out_len)
+{
+    command_args_t args;
+    command_result_t result;
+    memset(&args, 0, sizeof(args));
+    memset(&result, 0, sizeof(result));
+
+    command_status_t status = command_router_decode(id, in_format, in, in_len, &args);
+    if (status == COMMAND_OK)
+    {
+        status = command_router_dispatch(id, &args, &result);
+    }
+    if (status == COMMAND_OK)
+    {
+        status = command_router_encode(id, out_format, &result, out, out_size, out_len);
+    }
+    return status;
+}
+
+const char *command_router_status_name(command_status_t status)
+{
+    switch (status)
+    {
+    case COMMAND_OK:                return "ok";
+    case COMMAND_ERR_UNKNOWN:       return "unknown command";
+    case COMMAND_ERR_SYNTAX:        return "syntax error";
+    case COMMAND_ERR_MISSING_FIELD: return "missing argument";
+    case COMMAND_ERR_BAD_VALUE:     return "bad argument value";
+    case COMMAND_ERR_TOO_LONG:      return "argument too long";
+    case COMMAND_ERR_NO_SPACE:      return "response too large";
+    case COMMAND_ERR_FAILED:        return "command failed";
+    }
+    return "unknown status";
+}
+
+/* ========== DECODE BENCHMARK ========== */
+
+#if CONFIG_COMMAND_ROUTER_BENCHMARK
+
+extern const command_sample_t g_command_samples[COMMAND_COUNT];
+
+#define BENCH_ROUNDS 1000
+
+static uint32_t bench_one(uint8_t id, command_format_t format, const char *in, size_t len)
+{
+    command_args_t args;
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        command_router_decode(id, format, in, len, &args);
+    }
+    return (esp_cpu_get_cycle_count() - start) / BENCH_ROUNDS;
+}
+
+void command_router_benchmark(void)
+{
+    ESP_LOGI(TAG, "Decode cost in CPU cycles (avg of %d):", BENCH_ROUNDS);
+    for (size_t i = 0; i < COMMAND_COUNT; i++)
+    {
+        const command_sample_t *s = &g_command_samples[i];
+        const command_desc_t *cmd = command_router_find(s->id);
+        if (cmd == NULL)
+        {
+            continue; /* switched off in Kconfig */
+        }
+        ESP_LOGI(TAG, "  %-14s form=%" PRIu32 " json=%" PRIu32 " cbor=%" PRIu32,
+                 cmd->name,
+                 bench_one(s->id, COMMAND_FORMAT_FORM, s->form, s->form_len),
+                 bench_one(s->id, COMMAND_FORMAT_JSON, s->json, s->json_len),
+                 bench_one(s->id, COMMAND_FORMAT_CBOR, s->cbor, s->cbor_len));
+    }
+}
+
+#else
+
+void command_router_benchmark(void)
+{
+    ESP_LOGI(TAG, "Enable CONFIG_COMMAND_ROUTER_BENCHMARK to measure decode cost");
+}
+
+#endif
@@ -0,0 +1,66 @@
+/* ======================= COMMAND HANDLERS ======================= */
+/*
+ * One function per command in commands.json.
+ * Arguments arrive already decoded and checked by the router, so these
+ * only have to do the actual work and fill in the result.
+ */
+
+#include "Command_Router.h"
+
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+#include "LED_Controler.h"
+#include "Storage_Manager.h"
+
+command_status_t cmd_led_set_handler(const cmd_led_set_args_t *args, cmd_led_set_result_t *result)
+{
+    led_control_set(args->state);
+    result->state = led_control_is_on();
+    return COMMAND_OK;
+}
+
+command_status_t cmd_led_get_handler(const cmd_led_get_args_t *args, cmd_led_get_result_t *result)
+{
+    (void)args;
+    result->state = led_control_is_on();
+    return COMMAND_OK;
+}
+
+command_status_t cmd_string_get_handler(const cmd_string_get_args_t *args, cmd_string_get_result_t *result)
+{
+    (void)args;
+    storage_manager_get_string(result->value, sizeof(result->value));
+    return COMMAND_OK;
+}
+
+command_status_t cmd_string_set_handler(const cmd_string_set_args_t *args, cmd_string_set_result_t *result)
+{
+    (void)result;
+    storage_manager_save_string(args->value);
+    return COMMAND_OK;
+}
+
+command_status_t cmd_string_delete_handler(const cmd_string_delete_args_t *args, cmd_string_delete_result_t *result)
+{
+    (void)args;
+    (void)result;
+    storage_manager_delete_string();
+    return COMMAND_OK;
+}
+
+#if CONFIG_COMMAND_ROUTER_TELEMETRY
+command_status_t cmd_telemetry_handler(const cmd_telemetry_args_t *args, cmd_telemetry_result_t *result)
+{
+    (void)args;
+    result->uptime_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    result->free_heap = esp_get_free_heap_size();
+    result->min_free_heap = esp_get_minimum_free_heap_size();
+    result->led = led_control_is_on();
+    result->storage_flush_errors = storage_manager_flush_errors();
+    return COMMAND_OK;
+}
+#endif
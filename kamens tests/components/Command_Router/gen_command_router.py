@@ -0,0 +1,208 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+"""Generate the command router tables from commands.json.
+
+Writes command_router_gen.h (ids, argument/result structs, handler
+prototypes) and command_router_gen.c (field descriptors, dispatch table and
+sample payloads for the decode benchmark) into --out-dir.
+A command with "kconfig": "SYMBOL" is only compiled in when CONFIG_SYMBOL is set.
+Run by the component's CMakeLists.txt; there is no need to call it by hand.
+"""
+import argparse
+import json
+import os
+import sys
+from typing import Any, Dict, List
+from urllib.parse import quote
+
+FIELD_TYPES = {
+    'bool': ('bool', 'COMMAND_FIELD_BOOL'),
+    'u32': ('uint32_t', 'COMMAND_FIELD_U32'),
+    'string': ('char', 'COMMAND_FIELD_STRING'),
+}
+
+HEADER_BANNER = '/* Generated by gen_command_router.py from commands.json - do not edit. */\n'
+
+
+def fail(message: str) -> None:
+    sys.exit(f'gen_command_router: {message}')
+
+
+def validate(commands: List[Dict[str, Any]]) -> None:
+    ids = sorted(cmd['id'] for cmd in commands)
+    if ids != list(range(1, len(commands) + 1)):
+        fail(f'command ids must be 1..{len(commands)} without gaps, got {ids}')
+    for cmd in commands:
+        if not cmd['name'].isidentifier():
+            fail(f"bad command name '{cmd['name']}'")
+        for field in cmd.get('args', []) + cmd.get('result', []):
+            if field['type'] not in FIELD_TYPES:
+                fail(f"{cmd['name']}.{field['name']}: unknown type '{field['type']}'")
+            if field['type'] == 'string' and not 0 < field.get('max_len', 0) < 256:
+                fail(f"{cmd['name']}.{field['name']}: strings need a max_len of 1..255")
+        if 'kconfig' in cmd and not cmd['kconfig'].replace('_', '').isalnum():
+            fail(f"{cmd['name']}: kconfig must be a Kconfig symbol without the CONFIG_ prefix")
+        if len(cmd.get('args', [])) > 32:
+            fail(f"{cmd['name']}: at most 32 arguments")
+
+
+def struct_body(fields: List[Dict[str, Any]]) -> str:
+    if not fields:
+        return '    uint8_t reserved; /* C does not allow empty structs */\n'
+    lines = []
+    for field in fields:
+        c_type = FIELD_TYPES[field['type']][0]
+        if field['type'] == 'string':
+            lines.append(f"    {c_type} {field['name']}[{field['max_len'] + 1}];\n")
+        else:
+            lines.append(f"    {c_type} {field['name']};\n")
+    return ''.join(lines)
+
+
+def gen_header(commands: List[Dict[str, Any]]) -> str:
+    out = [HEADER_BANNER, '#pragma once\n\n#include <stdbool.h>\n#include <stdint.h>\n\n']
+    out.append('/* Included from Command_Router.h, after command_status_t is defined. */\n\n')
+    out.append(f'#define COMMAND_COUNT {len(commands)}\n\n')
+    out.append('typedef enum\n{\n')
+    for cmd in commands:
+        out.append(f"    CMD_{cmd['name'].upper()} = {cmd['id']}, /* {cmd.get('doc', '')} */\n")
+    out.append('} command_id_t;\n')
+
+    for cmd in commands:
+        name = cmd['name']
+        out.append(f'\ntypedef struct\n{{\n{struct_body(cmd.get("args", []))}}} cmd_{name}_args_t;\n')
+        out.append(f'\ntypedef struct\n{{\n{struct_body(cmd.get("result", []))}}} cmd_{name}_result_t;\n')
+
+    out.append('\n/* Big enough for the arguments / result of any command. */\n')
+    out.append('typedef union\n{\n')
+    out.extend(f"    cmd_{cmd['name']}_args_t {cmd['name']};\n" for cmd in commands)
+    out.append('} command_args_t;\n\n')
+    out.append('typedef union\n{\n')
+    out.extend(f"    cmd_{cmd['name']}_result_t {cmd['name']};\n" for cmd in commands)
+    out.append('} command_result_t;\n\n')
+
+    out.append('/* Implemented by hand in command_handlers.c. */\n')
+    for cmd in commands:
+        name = cmd['name']
+        out.append(f'command_status_t cmd_{name}_handler(const cmd_{name}_args_t *args, cmd_{name}_result_t *result);\n')
+    return ''.join(out)
+
+
+def field_table(table: str, struct: str, fields: List[Dict[str, Any]]) -> str:
+    if not fields:
+        return ''
+    out = [f'static const command_field_t {table}[] = {{\n']
+    for field in fields:
+        max_len = field.get('max_len', 0)
+        out.append(f"    {{\"{field['name']}\", {FIELD_TYPES[field['type']][1]}, "
+                   f"offsetof({struct}, {field['name']}), {max_len}}},\n")
+    out.append('};\n')
+    return ''.join(out)
+
+
+def c_bytes(data: bytes) -> str:
+    return '"' + ''.join(f'\\x{b:02x}' for b in data) + '"'
+
+
+def cbor_head(major: int, value: int) -> bytes:
+    if value < 24:
+        return bytes([major << 5 | value])
+    if value < 0x100:
+        return bytes([major << 5 | 24, value])
+    if value < 0x10000:
+        return bytes([major << 5 | 25]) + value.to_bytes(2, 'big')
+    return bytes([major << 5 | 26]) + value.to_bytes(4, 'big')
+
+
+def cbor_encode(sample: Dict[str, Any]) -> bytes:
+    out = bytearray(cbor_head(5, len(sample)))
+    for key, value in sample.items():
+        out += cbor_head(3, len(key.encode())) + key.encode()
+        if isinstance(value, bool):
+            out.append(0xF5 if value else 0xF4)
+        elif isinstance(value, int):
+            out += cbor_head(0, value)
+        else:
+            out += cbor_head(3, len(value.encode())) + value.encode()
+    return bytes(out)
+
+
+def form_encode(sample: Dict[str, Any]) -> bytes:
+    def text(value: Any) -> str:
+        if isinstance(value, bool):
+            return 'on' if value else 'off'
+        return quote(str(value), safe='')
+    return '&'.join(f'{key}={text(value)}' for key, value in sample.items()).encode()
+
+
+def gen_source(commands: List[Dict[str, Any]]) -> str:
+    out = [HEADER_BANNER, '#include <stddef.h>\n\n#include "sdkconfig.h"\n\n#include "Command_Router.h"\n\n']
+    for cmd in commands:
+        name = cmd['name']
+        if 'kconfig' in cmd:
+            out.append(f"#if CONFIG_{cmd['kconfig']}\n")
+        out.append(field_table(f's_{name}_args', f'cmd_{name}_args_t', cmd.get('args', [])))
+        out.append(field_table(f's_{name}_result', f'cmd_{name}_result_t', cmd.get('result', [])))
+        out.append(f'static command_status_t {name}_thunk(const void *args, void *result)\n{{\n'
+                   f'    return cmd_{name}_handler(args, result);\n}}\n')
+        if 'kconfig' in cmd:
+            out.append('#endif\n')
+        out.append('\n')
+
+    out.append('const command_desc_t g_command_table[COMMAND_COUNT] = {\n')
+    for cmd in sorted(commands, key=lambda c: c['id']):
+        name = cmd['name']
+        args = f's_{name}_args' if cmd.get('args') else 'NULL'
+        result = f's_{name}_result' if cmd.get('result') else 'NULL'
+        # A command switched off in Kconfig keeps its id but has no handler, so lookups skip it.
+        guard = cmd.get('kconfig')
+        out.append(f'    {{\n'
+                   f'        .name = "{name}",\n'
+                   f'        .id = CMD_{name.upper()},\n')
+        if guard:
+            out.append(f'#if CONFIG_{guard}\n')
+        out.append(f'        .args = {args},\n'
+                   f"        .arg_count = {len(cmd.get('args', []))},\n"
+                   f'        .result = {result},\n'
+                   f"        .result_count = {len(cmd.get('result', []))},\n"
+                   f'        .handler = {name}_thunk,\n')
+        if guard:
+            out.append('#endif\n')
+        out.append('    },\n')
+    out.append('};\n')
+
+    out.append('\n#if CONFIG_COMMAND_ROUTER_BENCHMARK\n')
+    out.append('const command_sample_t g_command_samples[COMMAND_COUNT] = {\n')
+    for cmd in sorted(commands, key=lambda c: c['id']):
+        sample = cmd.get('sample', {})
+        form = form_encode(sample)
+        js = json.dumps(sample, separators=(',', ':')).encode()
+        cbor = cbor_encode(sample)
+        out.append(f"    {{CMD_{cmd['name'].upper()}, {c_bytes(form)}, {len(form)}, "
+                   f'{c_bytes(js)}, {len(js)}, {c_bytes(cbor)}, {len(cbor)}}},\n')
+    out.append('};\n#endif\n')
+    return ''.join(out)
+
+
+def write(path: str, text: str) -> None:
+    with open(path, 'w', encoding='utf-8') as f:
+        f.write(text)
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--schema', required=True)
+    parser.add_argument('--out-dir', required=True)
+    args = parser.parse_args()
+
+    with open(args.schema, encoding='utf-8') as f:
+        commands = json.load(f)['commands']
+    validate(commands)
+
+    os.makedirs(args.out_dir, exist_ok=True)
+    write(os.path.join(args.out_dir, 'command_router_gen.h'), gen_header(commands))
+    write(os.path.join(args.out_dir, 'command_router_gen.c'), gen_source(commands))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ======================= COMMAND ROUTER HEADER ======================= */
+/*
+ * One place that knows how to decode, check and run every device command,
+ * no matter which transport (HTTP, serial, ...) the command came in on.
+ *
+ * The commands themselves live in commands.json. At build time
+ * gen_command_router.py turns that file into command_router_gen.h/.c:
+ * the CMD_xxx ids, one cmd_xxx_args_t / cmd_xxx_result_t struct per
+ * command, and the dispatch table. Handlers are written by hand in
+ * command_handlers.c.
+ *
+ * Nothing here allocates. Arguments are decoded into caller-owned structs
+ * and results are encoded into caller-owned buffers.
+ */
+
+typedef enum
+{
+    COMMAND_OK = 0,
+    COMMAND_ERR_UNKNOWN,       /* no command with that id / name */
+    COMMAND_ERR_SYNTAX,        /* input is not valid form / JSON / CBOR */
+    COMMAND_ERR_MISSING_FIELD, /* a required argument was not given */
+    COMMAND_ERR_BAD_VALUE,     /* an argument has the wrong type or value */
+    COMMAND_ERR_TOO_LONG,      /* a string argument is longer than its max_len */
+    COMMAND_ERR_NO_SPACE,      /* output buffer too small */
+    COMMAND_ERR_FAILED,        /* the handler ran but could not do the job */
+} command_status_t;
+
+typedef enum
+{
+    COMMAND_FORMAT_FORM, /* key=value&key=value, URL encoded */
+    COMMAND_FORMAT_JSON, /* flat JSON object */
+    COMMAND_FORMAT_CBOR, /* CBOR map with text keys */
+} command_format_t;
+
+typedef enum
+{
+    COMMAND_FIELD_BOOL,
+    COMMAND_FIELD_U32,
+    COMMAND_FIELD_STRING,
+} command_field_type_t;
+
+/* One argument or result field, as described in commands.json. */
+typedef struct
+{
+    const char *name;
+    command_field_type_t type;
+    uint16_t offset;  /* offsetof() the field inside its struct */
+    uint16_t max_len; /* strings only, without the terminating '\0' */
+} command_field_t;
+
+typedef command_status_t (*command_handler_t)(const void *args, void *result);
+
+/* One row of the generated dispatch table. */
+typedef struct
+{
+    const char *name;
+    uint8_t id;
+    const command_field_t *args;
+    uint8_t arg_count;
+    const command_field_t *result;
+    uint8_t result_count;
+    command_handler_t handler;
+} command_desc_t;
+
+/* Pre-encoded sample arguments, used by the decode benchmark. */
+typedef struct
+{
+    uint8_t id;
+    const char *form;
+    size_t form_len;
+    const char *json;
+    size_t json_len;
+    const char *cbor;
+    size_t cbor_len;
+} command_sample_t;
+
+#include "command_router_gen.h"
+
+extern const command_desc_t g_command_table[COMMAND_COUNT];
+
+/* Look a command up by id or by name. Returns NULL if there is no such command. */
+const command_desc_t *command_router_find(uint8_t id);
+const command_desc_t *command_router_find_by_name(const char *name, size_t name_len);
+
+/*
+ * Decode arguments for command id from in[0..len) into args, which must
+ * point at that command's cmd_xxx_args_t (or a command_args_t).
+ * Unknown keys are ignored, every declared argument is required.
+ */
+command_status_t command_router_decode(uint8_t id, command_format_t format,
+                                       const void *in, size_t len, void *args);
+
+/* Run the handler for command id. */
+command_status_t command_router_dispatch(uint8_t id, const void *args, void *result);
+
+/*
+ * Encode a result struct for command id into out. On success *out_len is
+ * set to the number of bytes written (JSON and form output is also
+ * '\0' terminated, not counted in *out_len).
+ */
+command_status_t command_router_encode(uint8_t id, command_format_t format, const void *result,
+                                       void *out, size_t out_size, size_t *out_len);
+
+/* Decode + dispatch + encode in one go. */
+command_status_t command_router_execute(uint8_t id, command_format_t in_format, const void *in, size_t in_len,
+                                        command_format_t out_format, void *out, size_t out_size, size_t *out_len);
+
+/* Short English description of a status, for error responses and logs. */
+const char *command_router_status_name(command_status_t status);
+
+/* Time every decoder on the sample payloads and log cycles per decode (CONFIG_COMMAND_ROUTER_BENCHMARK). */
+void command_router_benchmark(void);
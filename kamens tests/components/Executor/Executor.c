@@ -0,0 +1,174 @@
+/* ======================= DEFERRED WORK EXECUTOR ======================= */
+/*
+ * A few worker tasks, pinned per core, each owning one job queue per priority.
+ *
+ * Submitting picks a worker round-robin and pushes to its queue. A worker
+ * always runs the most urgent job it can find: its own queue first, then the
+ * same priority on the other workers (stealing), before moving down a level.
+ *
+ * Workers sleep on a task notification. A worker announces it is going idle
+ * in s_idle_mask and then checks the queues once more, so a job pushed in
+ * between is never missed. Submitters wake the chosen worker if it is idle,
+ * or otherwise any idle worker so that it can steal the job.
+ */
+
+#include "Executor.h"
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+static const char *TAG = "executor";
+
+#define WORKER_COUNT (CONFIG_EXECUTOR_WORKERS_PER_CORE * CONFIG_FREERTOS_NUMBER_OF_CORES)
+#define QUEUE_DEPTH CONFIG_EXECUTOR_QUEUE_DEPTH
+
+_Static_assert((QUEUE_DEPTH & (QUEUE_DEPTH - 1)) == 0, "CONFIG_EXECUTOR_QUEUE_DEPTH must be a power of two");
+_Static_assert(WORKER_COUNT <= 32, "idle mask is 32 bits");
+
+typedef struct
+{
+    TaskHandle_t task;
+    executor_queue_t queues[EXECUTOR_PRIO_COUNT];
+    executor_slot_t slots[EXECUTOR_PRIO_COUNT][QUEUE_DEPTH];
+} worker_t;
+
+static worker_t s_workers[WORKER_COUNT];
+static atomic_bool s_running = false;
+static atomic_uint s_next_worker = 0;
+static atomic_uint s_idle_mask = 0;
+
+/* Take the most urgent job: own queue first, then steal at the same priority. */
+static bool take_job(unsigned self, executor_job_t *job)
+{
+    for (int prio = 0; prio < EXECUTOR_PRIO_COUNT; prio++)
+    {
+        for (unsigned i = 0; i < WORKER_COUNT; i++)
+        {
+            unsigned victim = (self + i) % WORKER_COUNT;
+            if (executor_queue_pop(&s_workers[victim].queues[prio], job))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void worker_task(void *param)
+{
+    unsigned self = (unsigned)(uintptr_t)param;
+    unsigned bit = 1u << self;
+    executor_job_t job;
+
+    while (true)
+    {
+        if (!take_job(self, &job))
+        {
+            atomic_fetch_or(&s_idle_mask, bit);
+            if (!take_job(self, &job))
+            {
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+                atomic_fetch_and(&s_idle_mask, ~bit);
+                continue;
+            }
+            atomic_fetch_and(&s_idle_mask, ~bit);
+        }
+
+        int result = job.fn(job.arg);
+        if (job.done != NULL)
+        {
+            job.done(result, job.done_arg);
+        }
+    }
+}
+
+esp_err_t executor_start(void)
+{
+    if (atomic_load(&s_running))
+    {
+        return ESP_OK;
+    }
+
+    for (unsigned w = 0; w < WORKER_COUNT; w++)
+    {
+        for (int prio = 0; prio < EXECUTOR_PRIO_COUNT; prio++)
+        {
+            executor_queue_init(&s_workers[w].queues[prio], s_workers[w].slots[prio], QUEUE_DEPTH);
+        }
+    }
+
+    for (unsigned w = 0; w < WORKER_COUNT; w++)
+    {
+        char name[configMAX_TASK_NAME_LEN];
+        snprintf(name, sizeof(name), "exec%u", w);
+        BaseType_t core = (BaseType_t)(w % CONFIG_FREERTOS_NUMBER_OF_CORES);
+        if (xTaskCreatePinnedToCore(worker_task, name, CONFIG_EXECUTOR_STACK_SIZE, (void *)(uintptr_t)w,
+                                    CONFIG_EXECUTOR_TASK_PRIORITY, &s_workers[w].task, core) != pdPASS)
+        {
+            ESP_LOGE(TAG, "Failed to create worker %u", w);
+            /* No job can have been queued yet (s_running is false), so the workers can just go. */
+            for (unsigned created = 0; created < w; created++)
+            {
+                vTaskDelete(s_workers[created].task);
+                s_workers[created].task = NULL;
+            }
+            atomic_store(&s_idle_mask, 0);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    atomic_store(&s_running, true);
+    ESP_LOGI(TAG, "Executor started with %d workers", WORKER_COUNT);
+    return ESP_OK;
+}
+
+esp_err_t executor_submit(executor_priority_t prio, executor_job_fn_t fn, void *arg,
+                          executor_done_fn_t done, void *done_arg)
+{
+    if (!atomic_load(&s_running))
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if ((unsigned)prio >= EXECUTOR_PRIO_COUNT || fn == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    executor_job_t job = {.fn = fn, .arg = arg, .done = done, .done_arg = done_arg};
+    unsigned start = atomic_fetch_add(&s_next_worker, 1);
+
+    for (unsigned i = 0; i < WORKER_COUNT; i++)
+    {
+        unsigned w = (start + i) % WORKER_COUNT;
+        if (!executor_queue_push(&s_workers[w].queues[prio], &job))
+        {
+            continue;
+        }
+
+        /* Pairs with the idle-mask update in worker_task so no wakeup is lost. */
+        atomic_thread_fence(memory_order_seq_cst);
+
+        /* Wake the owner if it sleeps, otherwise any sleeping worker so it can steal. */
+        unsigned idle = atomic_load(&s_idle_mask);
+        if (idle & (1u << w))
+        {
+            xTaskNotifyGive(s_workers[w].task);
+        }
+        else if (idle != 0)
+        {
+            xTaskNotifyGive(s_workers[__builtin_ctz(idle)].task);
+        }
+        return ESP_OK;
+    }
+
+    return ESP_ERR_NO_MEM;
+}
@@ -0,0 +1,85 @@
+/* ======================= EXECUTOR QUEUE ======================= */
+/*
+ * Each slot carries a sequence number that says whose turn it is:
+ *   seq == pos       -> free, a producer at position pos may fill it
+ *   seq == pos + 1   -> filled, a consumer at position pos may take it
+ * After taking it, the consumer sets seq to pos + capacity, which is the
+ * "free" value for the producer one lap later.
+ */
+
+#include "executor_queue.h"
+
+#include <stdint.h>
+
+void executor_queue_init(executor_queue_t *q, executor_slot_t *slots, size_t capacity)
+{
+    q->slots = slots;
+    q->mask = capacity - 1;
+    for (size_t i = 0; i < capacity; i++)
+    {
+        atomic_store_explicit(&slots[i].seq, i, memory_order_relaxed);
+    }
+    atomic_store_explicit(&q->head, 0, memory_order_relaxed);
+    atomic_store_explicit(&q->tail, 0, memory_order_relaxed);
+}
+
+bool executor_queue_push(executor_queue_t *q, const executor_job_t *job)
+{
+    size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+    for (;;)
+    {
+        executor_slot_t *slot = &q->slots[pos & q->mask];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                slot->job = *job;
+                atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+                return true;
+            }
+            /* CAS failure reloaded pos; try again. */
+        }
+        else if (diff < 0)
+        {
+            return false; /* full */
+        }
+        else
+        {
+            pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+        }
+    }
+}
+
+bool executor_queue_pop(executor_queue_t *q, executor_job_t *job)
+{
+    size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+    for (;;)
+    {
+        executor_slot_t *slot = &q->slots[pos & q->mask];
+        size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+
+        if (diff == 0)
+        {
+            if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                *job = slot->job;
+                atomic_store_explicit(&slot->seq, pos + q->mask + 1, memory_order_release);
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false; /* empty */
+        }
+        else
+        {
+            pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,169 @@
+/* ======================= EXECUTOR QUEUE HOST BENCHMARK ======================= */
+/*
+ * Measures throughput and push-to-pop latency of executor_queue on a PC,
+ * for a few producer / consumer mixes. Threads that find the queue full or
+ * empty yield and retry, so the numbers stay sane on machines with fewer
+ * cores than threads.
+ *
+ * Also checks that every pushed job is popped exactly once.
+ */
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "executor_queue.h"
+
+#define QUEUE_DEPTH 16
+#define JOBS_PER_PRODUCER 200000
+#define LATENCY_EVERY 16
+
+static executor_slot_t s_slots[QUEUE_DEPTH];
+static executor_queue_t s_queue;
+static atomic_size_t s_popped;
+static atomic_uint_fast64_t s_checksum;
+static size_t s_total_jobs;
+
+typedef struct
+{
+    uint64_t *samples;
+    size_t count;
+    size_t capacity;
+} latency_log_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static int dummy_job(void *arg)
+{
+    (void)arg;
+    return 0;
+}
+
+static void *producer(void *param)
+{
+    uintptr_t base = (uintptr_t)param * JOBS_PER_PRODUCER;
+    for (uintptr_t i = 0; i < JOBS_PER_PRODUCER; i++)
+    {
+        /* arg = push timestamp, done_arg = job number (for the exactly-once check). */
+        executor_job_t job = {dummy_job, (void *)(uintptr_t)now_ns(), NULL, (void *)(base + i + 1)};
+        while (!executor_queue_push(&s_queue, &job))
+        {
+            sched_yield();
+            job.arg = (void *)(uintptr_t)now_ns();
+        }
+    }
+    return NULL;
+}
+
+static void *consumer(void *param)
+{
+    latency_log_t *log = param;
+    executor_job_t job;
+    size_t n = 0;
+
+    while (atomic_load_explicit(&s_popped, memory_order_relaxed) < s_total_jobs)
+    {
+        if (!executor_queue_pop(&s_queue, &job))
+        {
+            sched_yield();
+            continue;
+        }
+        uint64_t latency = now_ns() - (uint64_t)(uintptr_t)job.arg;
+        job.fn(job.arg);
+        atomic_fetch_add_explicit(&s_checksum, (uintptr_t)job.done_arg, memory_order_relaxed);
+        atomic_fetch_add_explicit(&s_popped, 1, memory_order_relaxed);
+        if (n++ % LATENCY_EVERY == 0 && log->count < log->capacity)
+        {
+            log->samples[log->count++] = latency;
+        }
+    }
+    return NULL;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int run(int producers, int consumers)
+{
+    pthread_t threads[16];
+    latency_log_t logs[8];
+    size_t per_consumer = (size_t)producers * JOBS_PER_PRODUCER / LATENCY_EVERY + 1;
+
+    executor_queue_init(&s_queue, s_slots, QUEUE_DEPTH);
+    s_total_jobs = (size_t)producers * JOBS_PER_PRODUCER;
+    atomic_store(&s_popped, 0);
+    atomic_store(&s_checksum, 0);
+
+    for (int c = 0; c < consumers; c++)
+    {
+        logs[c].samples = malloc(per_consumer * sizeof(uint64_t));
+        logs[c].count = 0;
+        logs[c].capacity = per_consumer;
+    }
+
+    uint64_t start = now_ns();
+    for (int c = 0; c < consumers; c++)
+    {
+        pthread_create(&threads[c], NULL, consumer, &logs[c]);
+    }
+    for (int p = 0; p < producers; p++)
+    {
+        pthread_create(&threads[consumers + p], NULL, producer, (void *)(uintptr_t)p);
+    }
+    for (int t = 0; t < producers + consumers; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    /* Merge latency samples. */
+    size_t total = 0;
+    for (int c = 0; c < consumers; c++)
+    {
+        total += logs[c].count;
+    }
+    uint64_t *all = malloc(total * sizeof(uint64_t));
+    size_t k = 0;
+    for (int c = 0; c < consumers; c++)
+    {
+        memcpy(all + k, logs[c].samples, logs[c].count * sizeof(uint64_t));
+        k += logs[c].count;
+        free(logs[c].samples);
+    }
+    qsort(all, total, sizeof(uint64_t), cmp_u64);
+
+    uint64_t n = s_total_jobs;
+    int ok = atomic_load(&s_checksum) == n * (n + 1) / 2;
+    printf("{\"producers\": %d, \"consumers\": %d, \"jobs\": %" PRIu64 ", \"jobs_per_s\": %.0f, "
+           "\"latency_p50_ns\": %" PRIu64 ", \"latency_p99_ns\": %" PRIu64 ", \"exactly_once\": %s}\n",
+           producers, consumers, n, (double)n * 1e9 / (double)elapsed,
+           all[total / 2], all[total * 99 / 100], ok ? "true" : "false");
+    free(all);
+    return ok ? 0 : 1;
+}
+
+int main(void)
+{
+    static const int mixes[][2] = {{1, 1}, {2, 1}, {4, 1}, {1, 2}, {4, 2}, {4, 4}};
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(mixes) / sizeof(mixes[0]); i++)
+    {
+        failures += run(mixes[i][0], mixes[i][1]);
+    }
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "esp_err.h"
+
+#include "executor_queue.h"
+
+/* ======================= EXECUTOR HEADER ======================= */
+/*
+ * Small shared pool of worker tasks for "do this later" work.
+ *
+ * Callbacks that must return quickly (HTTP handlers, the WiFi event loop,
+ * NimBLE callbacks) hand their heavy work to the executor instead of doing
+ * it in place. Workers are pinned per core, each has one lock-free queue
+ * per priority, and an idle worker steals from busy ones.
+ *
+ * Jobs must not block for long; they share a handful of tasks.
+ * executor_submit() must not be called from an ISR.
+ */
+
+typedef enum
+{
+    EXECUTOR_PRIO_HIGH = 0, /* bring-up work other things wait on */
+    EXECUTOR_PRIO_NORMAL,   /* flash writes and similar */
+    EXECUTOR_PRIO_LOW,      /* logging, statistics */
+    EXECUTOR_PRIO_COUNT,
+} executor_priority_t;
+
+/* Create the worker tasks. Call once, early in app_main. */
+esp_err_t executor_start(void);
+
+/*
+ * Queue fn(arg) to run on a worker. If done is not NULL it is called right
+ * after, on the same worker, with fn's return value.
+ *
+ * Returns ESP_ERR_INVALID_STATE if the executor is not running and
+ * ESP_ERR_NO_MEM if every queue at that priority is full. In both cases
+ * nothing was queued and the caller should do the work itself.
+ */
+esp_err_t executor_submit(executor_priority_t prio, executor_job_fn_t fn, void *arg,
+                          executor_done_fn_t done, void *done_arg);
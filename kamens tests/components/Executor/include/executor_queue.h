@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef ESP_PLATFORM
+#include "soc/soc_caps.h"
+#endif
+
+/* ======================= EXECUTOR QUEUE HEADER ======================= */
+/*
+ * Bounded lock-free job queue used by the executor.
+ * Any number of tasks may push, and any number may pop: the owning worker
+ * pops from the front, and idle workers steal from it the same way.
+ * It is the classic sequence-numbered ring buffer (Dmitry Vyukov's bounded
+ * MPMC queue): one CAS per push or pop, no locks, no allocation.
+ *
+ * Plain C11 with no FreeRTOS dependency, so host_bench/ can build it on a PC.
+ */
+
+/* Runs on a worker task. The return value is passed to the done callback. */
+typedef int (*executor_job_fn_t)(void *arg);
+/* Called on the same worker right after the job, with the job's result. */
+typedef void (*executor_done_fn_t)(int result, void *arg);
+
+typedef struct
+{
+    executor_job_fn_t fn;
+    void *arg;
+    executor_done_fn_t done; /* optional */
+    void *done_arg;
+} executor_job_t;
+
+typedef struct
+{
+    atomic_size_t seq;
+    executor_job_t job;
+} executor_slot_t;
+
+/*
+ * Producers and consumers touch different counters. Where data goes through
+ * a cache (a PC, or chips whose internal RAM sits behind L1) they get a line
+ * each to avoid false sharing. Other chips run from uncached internal SRAM,
+ * where the padding would only cost RAM.
+ */
+#if !defined(ESP_PLATFORM) || defined(SOC_CACHE_INTERNAL_MEM_VIA_L1CACHE)
+#define EXECUTOR_QUEUE_COUNTER_ALIGN _Alignas(64)
+#else
+#define EXECUTOR_QUEUE_COUNTER_ALIGN
+#endif
+
+typedef struct
+{
+    executor_slot_t *slots;
+    size_t mask;
+    EXECUTOR_QUEUE_COUNTER_ALIGN atomic_size_t head;
+    EXECUTOR_QUEUE_COUNTER_ALIGN atomic_size_t tail;
+} executor_queue_t;
+
+/* slots must hold capacity entries, and capacity must be a power of two. */
+void executor_queue_init(executor_queue_t *q, executor_slot_t *slots, size_t capacity);
+
+/* Returns false if the queue is full. */
+bool executor_queue_push(executor_queue_t *q, const executor_job_t *job);
+
+/* Returns false if the queue is empty. */
+bool executor_queue_pop(executor_queue_t *q, executor_job_t *job);
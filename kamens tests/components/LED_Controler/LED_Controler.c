@@ -6,23 +6,38 @@
 
 #include "LED_Controler.h"
 
+#include <stdatomic.h>
+
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+
+#if !CONFIG_IDF_TARGET_LINUX
 #include "driver/gpio.h"
+#endif
 
 /*
  * We choose one GPIO pin to be our "blue LED".
  * On some ESP32 dev boards, GPIO2 has an on-board LED.
  * You might need to change this to the right pin for your board.
+ * On the linux target (host simulation) there is no pin, only the variable below.
  */
 #define LED_GPIO GPIO_NUM_32
 
 /* We keep the current LED state in a global variable.
  * 0 = off, 1 = on.
  * Only this file touches the variable, so no other file can break it.
+ * The HTTP task and the lwIP thread (UDP fast path) can both change it.
+ * The state and the pin are updated together inside s_led_mux, so the pin
+ * always shows what s_led_on says. The critical section is a few register
+ * writes long, so the lwIP thread never waits in any real sense.
+ * The variable stays atomic so led_control_is_on() can read it without the lock.
  */
-static int s_led_on = 0;
+static atomic_int s_led_on = 0;
+static portMUX_TYPE s_led_mux = portMUX_INITIALIZER_UNLOCKED;
 
 void led_control_init(void)
 {
+#if !CONFIG_IDF_TARGET_LINUX
     gpio_config_t io_conf = {
         .pin_bit_mask = (1ULL << LED_GPIO), /* which pin we use */
         .mode = GPIO_MODE_OUTPUT,                /* we will drive it, not read it */
@@ -31,6 +46,7 @@ void led_control_init(void)
         .intr_type = GPIO_INTR_DISABLE,
     };
     gpio_config(&io_conf);
+#endif
 
     /* Start with LED off - 0, Led on - 1. */
     led_control_set(0);
@@ -38,11 +54,29 @@ void led_control_init(void)
 
 void led_control_set(int on)
 {
-    s_led_on = on ? 1 : 0;
-    gpio_set_level(LED_GPIO, s_led_on);
+    int level = on ? 1 : 0;
+    portENTER_CRITICAL(&s_led_mux);
+    atomic_store_explicit(&s_led_on, level, memory_order_relaxed);
+#if !CONFIG_IDF_TARGET_LINUX
+    gpio_set_level(LED_GPIO, level);
+#endif
+    portEXIT_CRITICAL(&s_led_mux);
+}
+
+int led_control_toggle(void)
+{
+    /* Flip and write the pin in one critical section, so a concurrent set
+     * from another task can neither be lost nor leave the pin out of step. */
+    portENTER_CRITICAL(&s_led_mux);
+    int level = atomic_fetch_xor_explicit(&s_led_on, 1, memory_order_relaxed) ^ 1;
+#if !CONFIG_IDF_TARGET_LINUX
+    gpio_set_level(LED_GPIO, level);
+#endif
+    portEXIT_CRITICAL(&s_led_mux);
+    return level;
 }
 
 int led_control_is_on(void)
 {
-    return s_led_on;
+    return atomic_load_explicit(&s_led_on, memory_order_relaxed);
 }
@@ -6,7 +6,13 @@
 /*
  * This header is the "instruction sheet" for the LED helper.
  * It tells other C files which LED functions exist so they can use them.
+ *
+ * led_control_set() never blocks: it only holds a short critical section
+ * around the state and the GPIO write, so it is safe to call straight from
+ * the lwIP thread (see UDP_Control).
+ * led_control_toggle() flips the state and the pin in one step and returns the new state.
  */
 void led_control_init(void);
 void led_control_set(int on);
+int led_control_toggle(void);
 int led_control_is_on(void);
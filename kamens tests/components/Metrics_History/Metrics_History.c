@@ -0,0 +1,392 @@
+/* ======================= METRICS HISTORY ======================= */
+/*
+ * A 1 s esp_timer samples the metrics into the 1 s tier and rolls them up
+ * into the 1 minute and 10 minute tiers. HTTP requests are counted into a
+ * small log-scale histogram that the sampler turns into p50 / p99 and
+ * resets every second.
+ *
+ * esp_timer callbacks must not block, and a query can hold the history
+ * lock for a while, so the timer only notes the time and hands the sample
+ * to an executor worker. The worker waits briefly for the lock and
+ * otherwise skips that second; so does the timer while a sample job is
+ * still pending, and when the executor cannot take the job and the lock
+ * is busy. Skipped seconds are counted in s_dropped_samples.
+ */
+
+#include "Metrics_History.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+#include "Executor.h"
+#include "metrics_series.h"
+
+static const char *TAG = "metrics";
+
+/* ---- tiers ---- */
+
+static metrics_block_t s_blocks_1s[CONFIG_METRICS_HISTORY_BLOCKS_1S];
+static metrics_block_t s_blocks_1m[CONFIG_METRICS_HISTORY_BLOCKS_1M];
+static metrics_block_t s_blocks_10m[CONFIG_METRICS_HISTORY_BLOCKS_10M];
+
+static const uint32_t s_tier_seconds[METRICS_TIER_COUNT] = {1, 60, 600};
+static const char *const s_tier_names[METRICS_TIER_COUNT] = {"1s", "1m", "10m"};
+
+static metrics_series_t s_tiers[METRICS_TIER_COUNT];
+
+/* Guards s_tiers and s_rollups: the sampler writes, HTTP queries read. */
+static StaticSemaphore_t s_lock_buf;
+static SemaphoreHandle_t s_lock;
+
+/* ---- roll-up into the coarser tiers ---- */
+
+typedef enum
+{
+    AGG_MIN,
+    AGG_MAX,
+    AGG_SUM,
+} metric_agg_t;
+
+static const struct
+{
+    const char *name;
+    metric_agg_t agg;
+} s_metrics[METRIC_COUNT] = {
+    [METRIC_FREE_HEAP] = {"free_heap", AGG_MIN},
+    [METRIC_RSSI] = {"rssi", AGG_MIN},
+    [METRIC_REQUESTS] = {"requests", AGG_SUM},
+    [METRIC_LATENCY_P50] = {"latency_p50_us", AGG_MAX},
+    [METRIC_LATENCY_P99] = {"latency_p99_us", AGG_MAX},
+};
+
+/* The interval being collected for tier 1 (1 min) and tier 2 (10 min). */
+typedef struct
+{
+    bool active;
+    uint32_t interval; /* t / tier seconds */
+    int32_t values[METRIC_COUNT];
+} rollup_t;
+
+static rollup_t s_rollups[METRICS_TIER_COUNT];
+
+/* ---- request latency ---- */
+
+/*
+ * Log-scale histogram, 4 buckets per power of two (at most 1/8 off after
+ * taking the bucket middle). Values below 8 us get a bucket each.
+ */
+#define LATENCY_BUCKETS (8 + 29 * 4)
+
+static portMUX_TYPE s_request_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t s_latency_hist[LATENCY_BUCKETS];
+static uint32_t s_request_count;
+
+static metrics_source_fn_t s_sources[METRIC_COUNT];
+static esp_timer_handle_t s_timer;
+static uint32_t s_last_t; /* guarded by s_lock */
+static atomic_uint s_dropped_samples = 0;
+/* A sample job is queued or running; the timer skips its tick instead of queueing another. */
+static atomic_bool s_sample_pending = false;
+
+/* How long the sample job waits for a query to release the history. */
+#define SAMPLE_LOCK_WAIT pdMS_TO_TICKS(20)
+
+static unsigned latency_bucket(uint32_t us)
+{
+    if (us < 8)
+    {
+        return us;
+    }
+    unsigned msb = 31u - (unsigned)__builtin_clz(us);
+    return 8 + (msb - 3) * 4 + ((us >> (msb - 2)) & 3);
+}
+
+static int32_t latency_bucket_value(unsigned bucket)
+{
+    if (bucket < 8)
+    {
+        return (int32_t)bucket;
+    }
+    unsigned msb = 3 + (bucket - 8) / 4;
+    uint32_t width = 1u << (msb - 2);
+    uint32_t low = (1u << msb) | ((bucket - 8) % 4) * width;
+    return (int32_t)(low + width / 2);
+}
+
+static int32_t latency_percentile(const uint16_t *hist, uint32_t count, uint32_t pct)
+{
+    uint32_t rank = (count * pct + 99) / 100; /* nearest rank */
+    uint32_t seen = 0;
+    for (unsigned b = 0; b < LATENCY_BUCKETS; b++)
+    {
+        seen += hist[b];
+        if (seen >= rank)
+        {
+            return latency_bucket_value(b);
+        }
+    }
+    return 0;
+}
+
+void metrics_history_note_request(uint32_t latency_us)
+{
+    unsigned bucket = latency_bucket(latency_us);
+    portENTER_CRITICAL(&s_request_lock);
+    if (s_latency_hist[bucket] < UINT16_MAX)
+    {
+        s_latency_hist[bucket]++;
+    }
+    s_request_count++;
+    portEXIT_CRITICAL(&s_request_lock);
+}
+
+/* ---- sampling ---- */
+
+static void tier_append(metrics_tier_t tier, uint32_t t, const int32_t *values);
+
+/* Fold a row of the finer tier into the interval being collected for `tier`; append it once complete. */
+static void rollup_feed(metrics_tier_t tier, uint32_t t, const int32_t *values)
+{
+    rollup_t *r = &s_rollups[tier];
+    uint32_t interval = t / s_tier_seconds[tier];
+
+    if (r->active && interval != r->interval)
+    {
+        tier_append(tier, r->interval * s_tier_seconds[tier], r->values);
+        r->active = false;
+    }
+    if (!r->active)
+    {
+        memcpy(r->values, values, sizeof(r->values));
+        r->interval = interval;
+        r->active = true;
+        return;
+    }
+    for (int m = 0; m < METRIC_COUNT; m++)
+    {
+        switch (s_metrics[m].agg)
+        {
+        case AGG_MIN:
+            r->values[m] = values[m] < r->values[m] ? values[m] : r->values[m];
+            break;
+        case AGG_MAX:
+            r->values[m] = values[m] > r->values[m] ? values[m] : r->values[m];
+            break;
+        case AGG_SUM:
+            r->values[m] += values[m];
+            break;
+        }
+    }
+}
+
+static void tier_append(metrics_tier_t tier, uint32_t t, const int32_t *values)
+{
+    metrics_series_append(&s_tiers[tier], t, values);
+    if (tier + 1 < METRICS_TIER_COUNT)
+    {
+        rollup_feed(tier + 1, t, values);
+    }
+}
+
+/*
+ * Record the row for second t, waiting at most `wait` ticks for the lock.
+ * Returns false if it could not get the lock, or if a row for that second
+ * already exists; the requests seen so far then count towards the next row.
+ */
+static bool sample_record(uint32_t t, TickType_t wait)
+{
+    if (xSemaphoreTake(s_lock, wait) != pdTRUE)
+    {
+        return false;
+    }
+    /* Rows need distinct times, and a later one must not be invented: skip this second. */
+    if (t <= s_last_t)
+    {
+        xSemaphoreGive(s_lock);
+        return false;
+    }
+
+    uint16_t hist[LATENCY_BUCKETS];
+    uint32_t count;
+
+    portENTER_CRITICAL(&s_request_lock);
+    memcpy(hist, s_latency_hist, sizeof(hist));
+    count = s_request_count;
+    memset(s_latency_hist, 0, sizeof(s_latency_hist));
+    s_request_count = 0;
+    portEXIT_CRITICAL(&s_request_lock);
+
+    int32_t values[METRIC_COUNT];
+    values[METRIC_FREE_HEAP] = (int32_t)esp_get_free_heap_size();
+    values[METRIC_RSSI] = s_sources[METRIC_RSSI] ? s_sources[METRIC_RSSI]() : 0;
+    values[METRIC_REQUESTS] = (int32_t)count;
+    values[METRIC_LATENCY_P50] = count ? latency_percentile(hist, count, 50) : 0;
+    values[METRIC_LATENCY_P99] = count ? latency_percentile(hist, count, 99) : 0;
+
+    s_last_t = t;
+    tier_append(METRICS_TIER_1S, t, values);
+    xSemaphoreGive(s_lock);
+    return true;
+}
+
+/* Executor job: arg is the second the timer fired in. Waits only briefly, like any job should. */
+static int sample_job(void *arg)
+{
+    if (!sample_record((uint32_t)(uintptr_t)arg, SAMPLE_LOCK_WAIT))
+    {
+        atomic_fetch_add(&s_dropped_samples, 1);
+    }
+    atomic_store(&s_sample_pending, false);
+    return 0;
+}
+
+static void sample_cb(void *arg)
+{
+    (void)arg;
+    uint32_t t = metrics_history_now();
+    if (atomic_exchange(&s_sample_pending, true))
+    {
+        atomic_fetch_add(&s_dropped_samples, 1); /* the last job has not run yet */
+        return;
+    }
+    if (executor_submit(EXECUTOR_PRIO_LOW, sample_job, (void *)(uintptr_t)t, NULL, NULL) == ESP_OK)
+    {
+        return;
+    }
+    atomic_store(&s_sample_pending, false);
+    if (!sample_record(t, 0))
+    {
+        atomic_fetch_add(&s_dropped_samples, 1);
+    }
+}
+
+uint32_t metrics_history_dropped_samples(void)
+{
+    return atomic_load(&s_dropped_samples);
+}
+
+esp_err_t metrics_history_start(void)
+{
+    if (s_timer != NULL)
+    {
+        return ESP_OK;
+    }
+
+    s_lock = xSemaphoreCreateMutexStatic(&s_lock_buf);
+    metrics_series_init(&s_tiers[METRICS_TIER_1S], s_blocks_1s, CONFIG_METRICS_HISTORY_BLOCKS_1S, METRIC_COUNT);
+    metrics_series_init(&s_tiers[METRICS_TIER_1M], s_blocks_1m, CONFIG_METRICS_HISTORY_BLOCKS_1M, METRIC_COUNT);
+    metrics_series_init(&s_tiers[METRICS_TIER_10M], s_blocks_10m, CONFIG_METRICS_HISTORY_BLOCKS_10M,
+                        METRIC_COUNT);
+
+    const esp_timer_create_args_t args = {
+        .callback = sample_cb,
+        .name = "metrics",
+    };
+    esp_err_t err = esp_timer_create(&args, &s_timer);
+    if (err == ESP_OK)
+    {
+        err = esp_timer_start_periodic(s_timer, 1000 * 1000);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start sampling: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Sampling every second, %u bytes of history",
+             (unsigned)(sizeof(s_blocks_1s) + sizeof(s_blocks_1m) + sizeof(s_blocks_10m)));
+    return ESP_OK;
+}
+
+void metrics_history_set_source(metrics_id_t id, metrics_source_fn_t fn)
+{
+    if (id < METRIC_COUNT)
+    {
+        s_sources[id] = fn;
+    }
+}
+
+uint32_t metrics_history_now(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+/* ---- queries ---- */
+
+uint32_t metrics_history_tier_seconds(metrics_tier_t tier)
+{
+    return tier < METRICS_TIER_COUNT ? s_tier_seconds[tier] : 0;
+}
+
+const char *metrics_history_tier_name(metrics_tier_t tier)
+{
+    return tier < METRICS_TIER_COUNT ? s_tier_names[tier] : "?";
+}
+
+const char *metrics_history_metric_name(metrics_id_t id)
+{
+    return id < METRIC_COUNT ? s_metrics[id].name : "?";
+}
+
+bool metrics_history_span(metrics_tier_t tier, uint32_t *first, uint32_t *last)
+{
+    if (s_lock == NULL || tier >= METRICS_TIER_COUNT)
+    {
+        return false;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    bool found = metrics_series_span(&s_tiers[tier], first, last);
+    xSemaphoreGive(s_lock);
+    return found;
+}
+
+typedef struct
+{
+    metrics_row_t *rows;
+    size_t max_rows;
+    size_t count;
+} copy_ctx_t;
+
+static bool copy_row(uint32_t t, const int32_t *values, void *arg)
+{
+    copy_ctx_t *ctx = arg;
+    ctx->rows[ctx->count].t = t;
+    memcpy(ctx->rows[ctx->count].values, values, sizeof(ctx->rows[0].values));
+    return ++ctx->count < ctx->max_rows;
+}
+
+size_t metrics_history_query(metrics_tier_t tier, uint32_t from, uint32_t to, metrics_row_t *rows,
+                             size_t max_rows)
+{
+    if (s_lock == NULL || tier >= METRICS_TIER_COUNT || max_rows == 0)
+    {
+        return 0;
+    }
+    copy_ctx_t ctx = {.rows = rows, .max_rows = max_rows};
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    metrics_series_query(&s_tiers[tier], from, to, copy_row, &ctx);
+    xSemaphoreGive(s_lock);
+    return ctx.count;
+}
+
+void metrics_history_usage(metrics_tier_t tier, size_t *rows, size_t *bytes)
+{
+    *rows = 0;
+    *bytes = 0;
+    if (s_lock == NULL || tier >= METRICS_TIER_COUNT)
+    {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    metrics_series_usage(&s_tiers[tier], rows, bytes);
+    xSemaphoreGive(s_lock);
+}
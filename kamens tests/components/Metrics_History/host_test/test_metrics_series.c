@@ -0,0 +1,269 @@
+/* ======================= METRICS SERIES HOST TEST ======================= */
+/*
+ * Checks that metrics_series gives back exactly what was appended: steady
+ * and irregular timestamps, extreme values, ring wrap-around and range
+ * boundaries. Ends with one JSON line of bytes per row for a telemetry-like
+ * series (the numbers quoted in the README) and of query cost.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "metrics_series.h"
+
+#define VALUES 5
+#define MAX_ROWS 20000
+
+typedef struct
+{
+    uint32_t t;
+    int32_t v[VALUES];
+} row_t;
+
+static row_t s_expected[MAX_ROWS];
+static size_t s_expected_count;
+static int s_failures;
+
+#define CHECK(cond, ...)                                      \
+    do                                                        \
+    {                                                         \
+        if (!(cond))                                          \
+        {                                                     \
+            printf("FAIL %s:%d: ", __func__, __LINE__);       \
+            printf(__VA_ARGS__);                              \
+            printf("\n");                                     \
+            s_failures++;                                     \
+        }                                                     \
+    } while (0)
+
+/* xorshift, so runs are repeatable */
+static uint32_t s_rng = 0x9E3779B9;
+static uint32_t rng(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+typedef struct
+{
+    const row_t *expected;
+    size_t count;
+    size_t next;
+    int mismatches;
+} match_ctx_t;
+
+static bool match_row(uint32_t t, const int32_t *values, void *arg)
+{
+    match_ctx_t *ctx = arg;
+    if (ctx->next >= ctx->count || ctx->expected[ctx->next].t != t ||
+        memcmp(ctx->expected[ctx->next].v, values, sizeof(int32_t) * VALUES) != 0)
+    {
+        ctx->mismatches++;
+    }
+    ctx->next++;
+    return true;
+}
+
+/* Query [from, to] and compare with the rows of s_expected in that range (of the ones still held). */
+static void check_range(const metrics_series_t *series, uint32_t from, uint32_t to, const char *what)
+{
+    size_t first = 0;
+    uint32_t oldest, newest;
+    if (!metrics_series_span(series, &oldest, &newest))
+    {
+        CHECK(s_expected_count == 0, "%s: empty series", what);
+        return;
+    }
+    while (first < s_expected_count && (s_expected[first].t < from || s_expected[first].t < oldest))
+    {
+        first++;
+    }
+    size_t last = first;
+    while (last < s_expected_count && s_expected[last].t <= to)
+    {
+        last++;
+    }
+
+    match_ctx_t ctx = {.expected = &s_expected[first], .count = last - first};
+    size_t delivered = metrics_series_query(series, from, to, match_row, &ctx);
+    CHECK(delivered == ctx.count && ctx.next == ctx.count && ctx.mismatches == 0,
+          "%s [%u, %u]: got %zu rows, expected %zu, %d mismatches", what, from, to, delivered, ctx.count,
+          ctx.mismatches);
+}
+
+static void append(metrics_series_t *series, uint32_t t, const int32_t *v)
+{
+    CHECK(metrics_series_append(series, t, v), "append at t=%u rejected", t);
+    s_expected[s_expected_count].t = t;
+    memcpy(s_expected[s_expected_count].v, v, sizeof(int32_t) * VALUES);
+    s_expected_count++;
+}
+
+static void test_steady_and_irregular(void)
+{
+    static metrics_block_t blocks[64];
+    metrics_series_t series;
+    metrics_series_init(&series, blocks, 64, VALUES);
+    s_expected_count = 0;
+
+    uint32_t t = 1000;
+    int32_t v[VALUES] = {120000, -60, 0, 800, 2500};
+    for (int i = 0; i < 1500; i++)
+    {
+        /* Mostly 1 s apart, sometimes late or skipped, now and then a long gap. */
+        uint32_t r = rng();
+        t += (r % 10 == 0) ? 2 + r % 5 : (r % 97 == 0) ? 3600 : 1;
+        v[0] += (int32_t)(rng() % 2001) - 1000;
+        v[1] = -40 - (int32_t)(rng() % 50);
+        v[2] = (int32_t)(rng() % 30);
+        v[3] = 500 + (int32_t)(rng() % 1000);
+        v[4] = (rng() % 50 == 0) ? 250000 : 2000 + (int32_t)(rng() % 3000);
+        append(&series, t, v);
+    }
+
+    check_range(&series, 0, UINT32_MAX, "all");
+    check_range(&series, s_expected[100].t, s_expected[900].t, "middle");
+    check_range(&series, s_expected[100].t + 1, s_expected[100].t + 1, "single second");
+    check_range(&series, s_expected[1499].t, UINT32_MAX, "last row");
+    check_range(&series, s_expected[1499].t + 1, UINT32_MAX, "after the end");
+    check_range(&series, 0, 999, "before the start");
+}
+
+static void test_extremes(void)
+{
+    static metrics_block_t blocks[8];
+    metrics_series_t series;
+    metrics_series_init(&series, blocks, 8, VALUES);
+    s_expected_count = 0;
+
+    static const int32_t edge[] = {INT32_MIN, INT32_MAX, 0, -1, 1, INT32_MIN + 1, INT32_MAX - 1};
+    uint32_t t = 0;
+    for (int i = 0; i < 60; i++)
+    {
+        int32_t v[VALUES];
+        for (int k = 0; k < VALUES; k++)
+        {
+            v[k] = edge[(i * 3 + k) % 7];
+        }
+        t += (i == 30) ? 0x7FFFFFFFu : 1 + (uint32_t)(i % 3); /* one huge jump */
+        append(&series, t, v);
+    }
+    check_range(&series, 0, UINT32_MAX, "extremes");
+
+    int32_t v[VALUES] = {0};
+    CHECK(!metrics_series_append(&series, t, v), "same timestamp accepted");
+    CHECK(!metrics_series_append(&series, t - 5, v), "older timestamp accepted");
+}
+
+static void test_ring_wrap(void)
+{
+    static metrics_block_t blocks[4];
+    metrics_series_t series;
+    metrics_series_init(&series, blocks, 4, VALUES);
+    s_expected_count = 0;
+
+    int32_t v[VALUES] = {0};
+    for (uint32_t t = 1; t <= 5000; t++)
+    {
+        v[0] = (int32_t)(rng() % 100000); /* big deltas, so blocks fill fast */
+        append(&series, t, v);
+    }
+
+    uint32_t first, last;
+    CHECK(metrics_series_span(&series, &first, &last) && last == 5000 && first > 1, "span %u..%u", first, last);
+    size_t rows, bytes;
+    metrics_series_usage(&series, &rows, &bytes);
+    CHECK(rows == 5000 - first + 1, "usage says %zu rows, span holds %u", rows, 5000 - first + 1);
+    CHECK(bytes <= sizeof(blocks), "usage %zu bytes", bytes);
+    check_range(&series, 0, UINT32_MAX, "after wrap");
+    check_range(&series, first + 10, last - 10, "inside after wrap");
+}
+
+static bool stop_after_three(uint32_t t, const int32_t *values, void *arg)
+{
+    (void)t;
+    (void)values;
+    return ++*(int *)arg < 3;
+}
+
+static void test_early_stop(void)
+{
+    static metrics_block_t blocks[4];
+    metrics_series_t series;
+    metrics_series_init(&series, blocks, 4, VALUES);
+    int32_t v[VALUES] = {0};
+    for (uint32_t t = 1; t <= 100; t++)
+    {
+        metrics_series_append(&series, t, v);
+    }
+    int seen = 0;
+    CHECK(metrics_series_query(&series, 10, 90, stop_after_three, &seen) == 3 && seen == 3, "did not stop");
+}
+
+static bool count_row(uint32_t t, const int32_t *values, void *arg)
+{
+    (void)t;
+    (void)values;
+    ++*(size_t *)arg;
+    return true;
+}
+
+/* Bytes per row of an hour of 1 s telemetry, and what a query costs. */
+static void report_density(void)
+{
+    static metrics_block_t blocks[256];
+    metrics_series_t series;
+    metrics_series_init(&series, blocks, 256, VALUES);
+
+    int32_t v[VALUES] = {150000, -55, 0, 900, 3000};
+    for (uint32_t t = 1; t <= 3600; t++)
+    {
+        v[0] += (int32_t)(rng() % 513) - 256; /* free heap drifts by a few hundred bytes */
+        v[1] = -50 - (int32_t)(rng() % 11);   /* RSSI jitters a few dB */
+        v[2] = (int32_t)(rng() % 4);          /* a few requests per second */
+        v[3] = v[2] ? 700 + (int32_t)(rng() % 400) : 0;
+        v[4] = v[2] ? 2000 + (int32_t)(rng() % 4000) : 0;
+        metrics_series_append(&series, t, v);
+    }
+    size_t rows, bytes;
+    metrics_series_usage(&series, &rows, &bytes);
+
+    struct timespec a, b;
+    size_t seen = 0;
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    for (int i = 0; i < 100; i++)
+    {
+        metrics_series_query(&series, 0, UINT32_MAX, count_row, &seen);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &b);
+    double full_ns = ((double)(b.tv_sec - a.tv_sec) * 1e9 + (double)(b.tv_nsec - a.tv_nsec)) / 100;
+
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    for (int i = 0; i < 100; i++)
+    {
+        metrics_series_query(&series, 3540, 3600, count_row, &seen);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &b);
+    double tail_ns = ((double)(b.tv_sec - a.tv_sec) * 1e9 + (double)(b.tv_nsec - a.tv_nsec)) / 100;
+
+    printf("{\"rows\": %zu, \"values_per_row\": %d, \"bytes\": %zu, \"bytes_per_row\": %.2f, "
+           "\"raw_bytes_per_row\": %zu, \"query_all_ns_per_row\": %.1f, \"query_last_minute_ns\": %.0f}\n",
+           rows, VALUES, bytes, (double)bytes / (double)rows, sizeof(uint32_t) * (1 + VALUES),
+           full_ns / (double)rows, tail_ns);
+}
+
+int main(void)
+{
+    test_steady_and_irregular();
+    test_extremes();
+    test_ring_wrap();
+    test_early_stop();
+    report_density();
+    printf("%s\n", s_failures ? "FAILED" : "OK");
+    return s_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/* ======================= METRICS HISTORY HEADER ======================= */
+/*
+ * Hours of telemetry in a few KB of RAM.
+ *
+ * Once a second a sampler records one row: free heap, WiFi RSSI, HTTP
+ * requests and their p50 / p99 latency. Rows are also rolled up into
+ * 1 minute and 10 minute tiers. Each tier is its own ring of compressed
+ * blocks (metrics_series.h), so the coarse tiers reach back much further
+ * than the 1 s one. Sizes are set in menuconfig ("Metrics history").
+ *
+ * Rolled-up rows keep the worst case of the interval: lowest free heap,
+ * lowest RSSI, highest latencies, and the total number of requests.
+ */
+
+typedef enum
+{
+    METRIC_FREE_HEAP,   /* bytes */
+    METRIC_RSSI,        /* dBm, 0 when not connected */
+    METRIC_REQUESTS,    /* HTTP requests in the interval */
+    METRIC_LATENCY_P50, /* microseconds, 0 without requests */
+    METRIC_LATENCY_P99, /* microseconds, 0 without requests */
+    METRIC_COUNT
+} metrics_id_t;
+
+typedef enum
+{
+    METRICS_TIER_1S,
+    METRICS_TIER_1M,
+    METRICS_TIER_10M,
+    METRICS_TIER_COUNT
+} metrics_tier_t;
+
+typedef struct
+{
+    uint32_t t; /* seconds since boot, start of the interval */
+    int32_t values[METRIC_COUNT];
+} metrics_row_t;
+
+/* Reads the current value of a metric the history cannot read itself (RSSI). */
+typedef int32_t (*metrics_source_fn_t)(void);
+
+/* Start sampling once a second. */
+esp_err_t metrics_history_start(void);
+
+void metrics_history_set_source(metrics_id_t id, metrics_source_fn_t fn);
+
+/* Count one HTTP request that took latency_us. Cheap enough for every request. */
+void metrics_history_note_request(uint32_t latency_us);
+
+/* Seconds that got no row: the history stayed busy, the previous sample was still pending, or the second already had a row. */
+uint32_t metrics_history_dropped_samples(void);
+
+/* Seconds since boot, the clock rows are stamped with. */
+uint32_t metrics_history_now(void);
+
+uint32_t metrics_history_tier_seconds(metrics_tier_t tier);
+const char *metrics_history_tier_name(metrics_tier_t tier);
+const char *metrics_history_metric_name(metrics_id_t id);
+
+/* Oldest and newest row of a tier. Returns false while it is empty. */
+bool metrics_history_span(metrics_tier_t tier, uint32_t *first, uint32_t *last);
+
+/*
+ * Copy up to max_rows rows with from <= t <= to, oldest first, and return
+ * how many were copied. For more, call again with from = last t + 1.
+ */
+size_t metrics_history_query(metrics_tier_t tier, uint32_t from, uint32_t to, metrics_row_t *rows,
+                             size_t max_rows);
+
+/* Rows held by a tier and the bytes they take. */
+void metrics_history_usage(metrics_tier_t tier, size_t *rows, size_t *bytes);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* ======================= METRICS SERIES HEADER ======================= */
+/*
+ * Compressed time series in a ring of fixed 256 byte blocks.
+ *
+ * A row is a timestamp (seconds) and up to METRICS_SERIES_MAX_VALUES
+ * int32 values. Inside a block the first row is stored in full (time in
+ * the block header, values as zigzag varints); every later row stores the
+ * delta-of-delta of its timestamp and the delta of each value from the
+ * previous row, all as zigzag varints. A series sampled at a steady rate
+ * whose values move a little costs 1 byte for the time and 1-2 bytes per
+ * value.
+ *
+ * Each block decodes on its own, so when the ring is full the oldest
+ * block is simply reused, and a range query skips every block whose
+ * [t0, t_last] does not overlap the range without decoding it.
+ *
+ * Plain C with no ESP-IDF dependency, so host_test/ can build it on a PC.
+ */
+
+#define METRICS_SERIES_MAX_VALUES 8
+
+#define METRICS_BLOCK_SIZE 256
+#define METRICS_BLOCK_DATA (METRICS_BLOCK_SIZE - 12)
+
+typedef struct
+{
+    uint32_t t0;     /* time of the first row */
+    uint32_t t_last; /* time of the last row */
+    uint16_t rows;
+    uint16_t used;   /* bytes of data[] in use */
+    uint8_t data[METRICS_BLOCK_DATA];
+} metrics_block_t;
+
+typedef struct
+{
+    metrics_block_t *blocks;
+    uint16_t block_count;
+    uint16_t head;   /* block being appended to */
+    uint16_t filled; /* blocks holding rows, at most block_count */
+    uint8_t value_count;
+    /* Encoder state: the last row appended */
+    uint32_t prev_t;
+    uint32_t prev_delta;
+    int32_t prev[METRICS_SERIES_MAX_VALUES];
+} metrics_series_t;
+
+/* Called once per row, oldest first. Return false to stop the query. */
+typedef bool (*metrics_row_fn_t)(uint32_t t, const int32_t *values, void *ctx);
+
+void metrics_series_init(metrics_series_t *series, metrics_block_t *blocks, uint16_t block_count,
+                         uint8_t value_count);
+
+/* Append a row. t must be later than the last row's; returns false (and drops the row) if not. */
+bool metrics_series_append(metrics_series_t *series, uint32_t t, const int32_t *values);
+
+/* Call fn for every row with from <= t <= to. Returns the number of rows passed to fn. */
+size_t metrics_series_query(const metrics_series_t *series, uint32_t from, uint32_t to, metrics_row_fn_t fn,
+                            void *ctx);
+
+/* Time of the oldest and newest row held. Returns false if the series is empty. */
+bool metrics_series_span(const metrics_series_t *series, uint32_t *first, uint32_t *last);
+
+/* Rows held and bytes they take, block headers included. */
+void metrics_series_usage(const metrics_series_t *series, size_t *rows, size_t *bytes);
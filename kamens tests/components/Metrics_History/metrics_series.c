@@ -0,0 +1,211 @@
+/* ======================= METRICS SERIES ======================= */
+/*
+ * See metrics_series.h for the block format.
+ *
+ * All arithmetic on times and values is done on uint32_t and wraps, and
+ * the decoder wraps the same way, so any int32 sequence round-trips
+ * exactly (a jump from INT32_MIN to INT32_MAX just costs 5 bytes).
+ */
+
+#include "metrics_series.h"
+
+#include <string.h>
+
+#define VARINT_MAX 5 /* bytes for a 32 bit varint */
+
+static inline uint32_t zigzag(uint32_t v)
+{
+    return (v << 1) ^ (uint32_t)-(int32_t)(v >> 31);
+}
+
+static inline uint32_t unzigzag(uint32_t v)
+{
+    return (v >> 1) ^ (uint32_t)-(int32_t)(v & 1);
+}
+
+static inline uint16_t put_varint(uint8_t *out, uint16_t pos, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        out[pos++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[pos++] = (uint8_t)v;
+    return pos;
+}
+
+/* Returns false if the varint runs past end (a block is never written that way; this guards the reader). */
+static inline bool get_varint(const uint8_t *in, uint16_t *pos, uint16_t end, uint32_t *v)
+{
+    uint32_t result = 0;
+    for (unsigned shift = 0; shift < 35 && *pos < end; shift += 7)
+    {
+        uint8_t byte = in[(*pos)++];
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+        {
+            *v = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+void metrics_series_init(metrics_series_t *series, metrics_block_t *blocks, uint16_t block_count,
+                         uint8_t value_count)
+{
+    memset(series, 0, sizeof(*series));
+    series->blocks = blocks;
+    series->block_count = block_count;
+    series->value_count = value_count > METRICS_SERIES_MAX_VALUES ? METRICS_SERIES_MAX_VALUES : value_count;
+}
+
+bool metrics_series_append(metrics_series_t *series, uint32_t t, const int32_t *values)
+{
+    if (series->block_count == 0 || (series->filled > 0 && t <= series->prev_t))
+    {
+        return false;
+    }
+
+    metrics_block_t *block = &series->blocks[series->head];
+    size_t worst_case = VARINT_MAX * (1u + series->value_count);
+
+    if (series->filled == 0 || block->used + worst_case > METRICS_BLOCK_DATA)
+    {
+        /* Start a new block, reusing the oldest one once the ring is full. */
+        if (series->filled > 0)
+        {
+            series->head = (uint16_t)((series->head + 1) % series->block_count);
+            block = &series->blocks[series->head];
+        }
+        if (series->filled < series->block_count)
+        {
+            series->filled++;
+        }
+        block->t0 = t;
+        block->rows = 0;
+        block->used = 0;
+        for (uint8_t i = 0; i < series->value_count; i++)
+        {
+            block->used = put_varint(block->data, block->used, zigzag((uint32_t)values[i]));
+        }
+        series->prev_delta = 0;
+    }
+    else
+    {
+        uint32_t delta = t - series->prev_t;
+        block->used = put_varint(block->data, block->used, zigzag(delta - series->prev_delta));
+        for (uint8_t i = 0; i < series->value_count; i++)
+        {
+            block->used = put_varint(block->data, block->used,
+                                     zigzag((uint32_t)values[i] - (uint32_t)series->prev[i]));
+        }
+        series->prev_delta = delta;
+    }
+
+    series->prev_t = t;
+    memcpy(series->prev, values, series->value_count * sizeof(int32_t));
+    block->t_last = t;
+    block->rows++;
+    return true;
+}
+
+static inline uint16_t oldest_block(const metrics_series_t *series)
+{
+    return series->filled < series->block_count ? 0 : (uint16_t)((series->head + 1) % series->block_count);
+}
+
+size_t metrics_series_query(const metrics_series_t *series, uint32_t from, uint32_t to, metrics_row_fn_t fn,
+                            void *ctx)
+{
+    size_t delivered = 0;
+    uint16_t index = oldest_block(series);
+
+    for (uint16_t n = 0; n < series->filled; n++, index = (uint16_t)((index + 1) % series->block_count))
+    {
+        const metrics_block_t *block = &series->blocks[index];
+        if (block->t_last < from)
+        {
+            continue; /* wholly before the range: not decoded at all */
+        }
+        if (block->t0 > to)
+        {
+            break; /* blocks are in time order, nothing later can match */
+        }
+
+        uint32_t t = block->t0;
+        uint32_t delta = 0;
+        int32_t values[METRICS_SERIES_MAX_VALUES];
+        uint16_t pos = 0;
+
+        for (uint16_t row = 0; row < block->rows; row++)
+        {
+            uint32_t v;
+            if (row == 0)
+            {
+                for (uint8_t i = 0; i < series->value_count; i++)
+                {
+                    if (!get_varint(block->data, &pos, block->used, &v))
+                    {
+                        return delivered;
+                    }
+                    values[i] = (int32_t)unzigzag(v);
+                }
+            }
+            else
+            {
+                if (!get_varint(block->data, &pos, block->used, &v))
+                {
+                    return delivered;
+                }
+                delta += unzigzag(v);
+                t += delta;
+                for (uint8_t i = 0; i < series->value_count; i++)
+                {
+                    if (!get_varint(block->data, &pos, block->used, &v))
+                    {
+                        return delivered;
+                    }
+                    values[i] = (int32_t)((uint32_t)values[i] + unzigzag(v));
+                }
+            }
+
+            if (t > to)
+            {
+                return delivered;
+            }
+            if (t >= from)
+            {
+                delivered++;
+                if (!fn(t, values, ctx))
+                {
+                    return delivered;
+                }
+            }
+        }
+    }
+    return delivered;
+}
+
+bool metrics_series_span(const metrics_series_t *series, uint32_t *first, uint32_t *last)
+{
+    if (series->filled == 0)
+    {
+        return false;
+    }
+    *first = series->blocks[oldest_block(series)].t0;
+    *last = series->prev_t;
+    return true;
+}
+
+void metrics_series_usage(const metrics_series_t *series, size_t *rows, size_t *bytes)
+{
+    *rows = 0;
+    *bytes = 0;
+    uint16_t index = oldest_block(series);
+    for (uint16_t n = 0; n < series->filled; n++, index = (uint16_t)((index + 1) % series->block_count))
+    {
+        *rows += series->blocks[index].rows;
+        *bytes += METRICS_BLOCK_SIZE - METRICS_BLOCK_DATA + series->blocks[index].used;
+    }
+}
@@ -0,0 +1,413 @@
+/* ======================= SERIAL CONTROL PROTOCOL ======================= */
+/*
+ * This file serves binary framed commands on the serial port.
+ * Framing is COBS (so 0x00 always means "frame boundary"), every frame
+ * carries a CRC-16 and a request id. See Serial_Control.h for the layout.
+ *
+ * One small task reads bytes, cuts them into frames at 0x00, checks them,
+ * runs the command and writes the answer back. Frames that fail to decode
+ * or fail the CRC are dropped quietly - they are usually just noise.
+ */
+
+#include "Serial_Control.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+
+#if CONFIG_SERIAL_CONTROL_TRANSPORT_USB_SERIAL_JTAG
+#include "driver/usb_serial_jtag.h"
+#include "driver/usb_serial_jtag_vfs.h"
+#else
+#include "driver/uart.h"
+#include "driver/uart_vfs.h"
+#endif
+
+#include "Command_Router.h"
+
+static const char *TAG = "serial_ctrl";
+
+/* Decoded frame: header (command + id, plus status on responses), payload, CRC. */
+#define FRAME_MAX_LEN (4 + SERIAL_CONTROL_MAX_PAYLOAD + 2)
+/* COBS adds one byte per 254 plus one; two more for the 0x00 delimiters. */
+#define WIRE_MAX_LEN (FRAME_MAX_LEN + FRAME_MAX_LEN / 254 + 1 + 2)
+
+#define SERIAL_TASK_STACK 4096
+#define SERIAL_TASK_PRIO 5
+#define SERIAL_RX_CHUNK 64
+
+/* ========== TRANSPORT ========== */
+
+#if CONFIG_SERIAL_CONTROL_TRANSPORT_USB_SERIAL_JTAG
+
+static esp_err_t transport_install(void)
+{
+    if (!usb_serial_jtag_is_driver_installed())
+    {
+        usb_serial_jtag_driver_config_t cfg = USB_SERIAL_JTAG_DRIVER_CONFIG_DEFAULT();
+        esp_err_t err = usb_serial_jtag_driver_install(&cfg);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+    /* Route log output through the driver too, so log lines and frames never interleave. */
+    usb_serial_jtag_vfs_use_driver();
+    return ESP_OK;
+}
+
+static int transport_read(uint8_t *buf, size_t len)
+{
+    return usb_serial_jtag_read_bytes(buf, len, portMAX_DELAY);
+}
+
+static void transport_write(const uint8_t *buf, size_t len)
+{
+    usb_serial_jtag_write_bytes(buf, len, portMAX_DELAY);
+}
+
+#else
+
+#define SERIAL_UART_NUM CONFIG_ESP_CONSOLE_UART_NUM
+#define SERIAL_UART_RX_BUF 512
+
+static esp_err_t transport_install(void)
+{
+    if (!uart_is_driver_installed(SERIAL_UART_NUM))
+    {
+        esp_err_t err = uart_driver_install(SERIAL_UART_NUM, SERIAL_UART_RX_BUF, 0, 0, NULL, 0);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+    }
+    /* Route log output through the driver too, so log lines and frames never interleave. */
+    uart_vfs_dev_use_driver(SERIAL_UART_NUM);
+    return ESP_OK;
+}
+
+static int transport_read(uint8_t *buf, size_t len)
+{
+    return uart_read_bytes(SERIAL_UART_NUM, buf, len, portMAX_DELAY);
+}
+
+static void transport_write(const uint8_t *buf, size_t len)
+{
+    /* One call per frame: the driver holds its TX lock for the whole write. */
+    uart_write_bytes(SERIAL_UART_NUM, buf, len);
+}
+
+#endif
+
+/* ========== FRAMING HELPERS ========== */
+
+/* CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), bit by bit - frames are tiny. */
+static uint16_t crc16_ccitt(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++)
+        {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* COBS encode len bytes of src into dst. Returns the encoded length. */
+static size_t cobs_encode(const uint8_t *src, size_t len, uint8_t *dst)
+{
+    size_t write = 1;
+    size_t code_idx = 0;
+    uint8_t code = 1;
+
+    for (size_t read = 0; read < len; read++)
+    {
+        if (src[read] == 0)
+        {
+            dst[code_idx] = code;
+            code = 1;
+            code_idx = write++;
+        }
+        else
+        {
+            dst[write++] = src[read];
+            code++;
+            if (code == 0xFF)
+            {
+                dst[code_idx] = code;
+                code = 1;
+                code_idx = write++;
+            }
+        }
+    }
+    dst[code_idx] = code;
+    return write;
+}
+
+/* COBS decode. Returns the decoded length, or 0 if the input is malformed. */
+static size_t cobs_decode(const uint8_t *src, size_t len, uint8_t *dst, size_t dst_len)
+{
+    size_t read = 0;
+    size_t write = 0;
+
+    while (read < len)
+    {
+        uint8_t code = src[read];
+        if (code == 0 || read + code > len || write + code - 1 > dst_len)
+        {
+            return 0;
+        }
+        read++;
+        memcpy(dst + write, src + read, code - 1);
+        write += code - 1;
+        read += code - 1;
+
+        /* A zero follows every block except a full one and the last one. */
+        if (code != 0xFF && read != len)
+        {
+            if (write >= dst_len)
+            {
+                return 0;
+            }
+            dst[write++] = 0;
+        }
+    }
+    return write;
+}
+
+#if CONFIG_COMMAND_ROUTER_TELEMETRY
+static void put_u32(uint8_t *dst, uint32_t value)
+{
+    dst[0] = (uint8_t)value;
+    dst[1] = (uint8_t)(value >> 8);
+    dst[2] = (uint8_t)(value >> 16);
+    dst[3] = (uint8_t)(value >> 24);
+}
+#endif
+
+/* ========== COMMANDS ========== */
+
+/*
+ * Run one command. Writes the response payload into out and its length
+ * into out_len, and returns a status code for the response header.
+ */
+static uint8_t handle_command(uint8_t cmd, const uint8_t *payload, size_t len,
+                              uint8_t *out, size_t *out_len)
+{
+    *out_len = 0;
+    if (len > SERIAL_CONTROL_MAX_PAYLOAD)
+    {
+        return SERIAL_STATUS_TOO_LONG;
+    }
+
+    /* Everything except PING runs through the shared command router handlers. */
+    command_args_t args;
+    command_result_t result;
+    memset(&args, 0, sizeof(args));
+    memset(&result, 0, sizeof(result));
+
+    switch (cmd)
+    {
+    case SERIAL_CMD_PING:
+        memcpy(out, payload, len);
+        *out_len = len;
+        return SERIAL_STATUS_OK;
+
+    case SERIAL_CMD_LED_SET:
+        if (len != 1)
+        {
+            return SERIAL_STATUS_BAD_REQUEST;
+        }
+        args.led_set.state = payload[0] != 0;
+        command_router_dispatch(CMD_LED_SET, &args, &result);
+        out[0] = result.led_set.state;
+        *out_len = 1;
+        return SERIAL_STATUS_OK;
+
+    case SERIAL_CMD_LED_GET:
+        command_router_dispatch(CMD_LED_GET, &args, &result);
+        out[0] = result.led_get.state;
+        *out_len = 1;
+        return SERIAL_STATUS_OK;
+
+    case SERIAL_CMD_STRING_GET:
+    {
+        command_router_dispatch(CMD_STRING_GET, &args, &result);
+        size_t value_len = strlen(result.string_get.value);
+        memcpy(out, result.string_get.value, value_len);
+        *out_len = value_len;
+        return SERIAL_STATUS_OK;
+    }
+
+    case SERIAL_CMD_STRING_SET:
+        if (len >= sizeof(args.string_set.value))
+        {
+            return SERIAL_STATUS_TOO_LONG;
+        }
+        if (memchr(payload, '\0', len) != NULL)
+        {
+            return SERIAL_STATUS_BAD_REQUEST;
+        }
+        memcpy(args.string_set.value, payload, len);
+        args.string_set.value[len] = '\0';
+        command_router_dispatch(CMD_STRING_SET, &args, &result);
+        return SERIAL_STATUS_OK;
+
+    case SERIAL_CMD_STRING_DELETE:
+        command_router_dispatch(CMD_STRING_DELETE, &args, &result);
+        return SERIAL_STATUS_OK;
+
+#if CONFIG_COMMAND_ROUTER_TELEMETRY
+    case SERIAL_CMD_TELEMETRY:
+        command_router_dispatch(CMD_TELEMETRY, &args, &result);
+        put_u32(out, result.telemetry.uptime_ms);
+        put_u32(out + 4, result.telemetry.free_heap);
+        put_u32(out + 8, result.telemetry.min_free_heap);
+        out[12] = result.telemetry.led;
+        put_u32(out + 13, result.telemetry.storage_flush_errors);
+        *out_len = 17;
+        return SERIAL_STATUS_OK;
+#endif
+
+    case SERIAL_CMD_ROUTER:
+    {
+        if (len < 1)
+        {
+            return SERIAL_STATUS_BAD_REQUEST;
+        }
+        command_status_t status = command_router_execute(payload[0], COMMAND_FORMAT_CBOR, payload + 1, len - 1,
+                                                         COMMAND_FORMAT_CBOR, out, SERIAL_CONTROL_MAX_PAYLOAD, out_len);
+        switch (status)
+        {
+        case COMMAND_OK:
+            return SERIAL_STATUS_OK;
+        case COMMAND_ERR_UNKNOWN:
+            return SERIAL_STATUS_UNKNOWN_COMMAND;
+        case COMMAND_ERR_TOO_LONG:
+        case COMMAND_ERR_NO_SPACE:
+            *out_len = 0;
+            return SERIAL_STATUS_TOO_LONG;
+        case COMMAND_ERR_FAILED:
+            return SERIAL_STATUS_FAILED;
+        default:
+            return SERIAL_STATUS_BAD_REQUEST;
+        }
+    }
+
+    default:
+        return SERIAL_STATUS_UNKNOWN_COMMAND;
+    }
+}
+
+/* Check one decoded frame, run it and send the response. */
+static void handle_frame(const uint8_t *frame, size_t len)
+{
+    if (len < 5)
+    {
+        return;
+    }
+    uint16_t crc = (uint16_t)(frame[len - 2] | (frame[len - 1] << 8));
+    if (crc16_ccitt(frame, len - 2) != crc)
+    {
+        ESP_LOGD(TAG, "Dropping frame with bad CRC");
+        return;
+    }
+
+    uint8_t response[FRAME_MAX_LEN];
+    size_t payload_len = 0;
+
+    response[0] = frame[0] | SERIAL_CMD_RESPONSE_FLAG;
+    response[1] = frame[1];
+    response[2] = frame[2];
+    response[3] = handle_command(frame[0], frame + 3, len - 5, response + 4, &payload_len);
+
+    size_t response_len = 4 + payload_len;
+    crc = crc16_ccitt(response, response_len);
+    response[response_len++] = (uint8_t)crc;
+    response[response_len++] = (uint8_t)(crc >> 8);
+
+    uint8_t wire[WIRE_MAX_LEN];
+    wire[0] = 0;
+    size_t wire_len = 1 + cobs_encode(response, response_len, wire + 1);
+    wire[wire_len++] = 0;
+    transport_write(wire, wire_len);
+}
+
+static void serial_control_task(void *param)
+{
+    (void)param;
+
+    uint8_t chunk[SERIAL_RX_CHUNK];
+    uint8_t encoded[WIRE_MAX_LEN];
+    uint8_t frame[FRAME_MAX_LEN];
+    size_t encoded_len = 0;
+    bool overflow = false;
+
+    while (true)
+    {
+        int n = transport_read(chunk, sizeof(chunk));
+        for (int i = 0; i < n; i++)
+        {
+            if (chunk[i] != 0)
+            {
+                if (encoded_len < sizeof(encoded))
+                {
+                    encoded[encoded_len++] = chunk[i];
+                }
+                else
+                {
+                    overflow = true;
+                }
+                continue;
+            }
+
+            /* 0x00: end of frame. Empty frames are just back-to-back delimiters. */
+            if (encoded_len > 0 && !overflow)
+            {
+                size_t frame_len = cobs_decode(encoded, encoded_len, frame, sizeof(frame));
+                if (frame_len > 0)
+                {
+                    handle_frame(frame, frame_len);
+                }
+            }
+            encoded_len = 0;
+            overflow = false;
+        }
+    }
+}
+
+esp_err_t serial_control_start(void)
+{
+    static TaskHandle_t task = NULL;
+    if (task != NULL)
+    {
+        return ESP_OK;
+    }
+
+    esp_err_t err = transport_install();
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to install serial driver: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if (xTaskCreate(serial_control_task, "serial_ctrl", SERIAL_TASK_STACK, NULL,
+                    SERIAL_TASK_PRIO, &task) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create serial control task");
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Serial control protocol ready");
+    return ESP_OK;
+}
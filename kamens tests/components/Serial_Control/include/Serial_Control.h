@@ -0,0 +1,46 @@
+#pragma once
+
+#include "esp_err.h"
+
+/* ======================= SERIAL CONTROL HEADER ======================= */
+/*
+ * Binary control protocol over the serial port, for when there is no network.
+ *
+ * On the wire every frame is COBS encoded and surrounded by 0x00 bytes, so
+ * log text on the same port can never be mistaken for a frame.
+ * A decoded frame looks like this (multi-byte fields are little endian):
+ *
+ *   request:  [command u8][request id u16][payload ...][crc16 u16]
+ *   response: [command | 0x80][request id u16][status u8][payload ...][crc16 u16]
+ *
+ * The CRC is CRC-16/CCITT-FALSE over everything before it.
+ * The request id is echoed back untouched, so a host can send many
+ * requests without waiting and match the answers afterwards (pipelining).
+ * tools/serial_control.py is the matching host client.
+ */
+#define SERIAL_CONTROL_MAX_PAYLOAD 128
+
+/* Commands. Payloads are listed as request -> response. */
+#define SERIAL_CMD_PING 0x01          /* any bytes -> same bytes */
+#define SERIAL_CMD_LED_SET 0x10       /* u8 on -> u8 state */
+#define SERIAL_CMD_LED_GET 0x11       /* none -> u8 state */
+#define SERIAL_CMD_STRING_GET 0x20    /* none -> string bytes */
+#define SERIAL_CMD_STRING_SET 0x21    /* string bytes -> none */
+#define SERIAL_CMD_STRING_DELETE 0x22 /* none -> none */
+#define SERIAL_CMD_TELEMETRY 0x30     /* none -> u32 uptime ms, u32 free heap, u32 min free heap, u8 led, u32 storage flush errors (CONFIG_COMMAND_ROUTER_TELEMETRY) */
+#define SERIAL_CMD_ROUTER 0x40        /* u8 command id + CBOR args -> CBOR result (see Command_Router.h) */
+
+#define SERIAL_CMD_RESPONSE_FLAG 0x80
+
+/* Response status codes. */
+#define SERIAL_STATUS_OK 0x00
+#define SERIAL_STATUS_BAD_REQUEST 0x01
+#define SERIAL_STATUS_UNKNOWN_COMMAND 0x02
+#define SERIAL_STATUS_TOO_LONG 0x03
+#define SERIAL_STATUS_FAILED 0x04
+
+/*
+ * Install the serial driver and start the task that serves requests.
+ * Does not need WiFi, so it can be started before the network comes up.
+ */
+esp_err_t serial_control_start(void);
@@ -6,24 +6,52 @@
 
 #include "Storage_Manager.h"
 
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <string.h>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 
 #include "esp_mac.h"
 
+#include "Executor.h"
+#include "storage_lz.h"
+
 /* Tiny logging tag for this module. */
 static const char *TAG = "storage";
 
 /* Configuration for where the string lives inside NVS. */
 #define STRING_NAMESPACE "storage"
 #define STRING_KEY "my_string"
-#define STRING_MAX_LEN 64
+#define STRING_MAX_LEN STORAGE_STRING_MAX_LEN
 
-/* Buffer in RAM that always mirrors the flash value. */
+/* Buffer in RAM that always mirrors the flash value (or the value about to be written). */
 static char s_stored_string[STRING_MAX_LEN] = {0};
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* s_dirty: RAM copy changed since the last flash write. s_flush_scheduled: a flush job is queued or running. */
+static atomic_bool s_dirty = false;
+static atomic_bool s_flush_scheduled = false;
+
+/* Failed background writes, for telemetry; the RAM copy then differs from flash until the next good flush. */
+static atomic_uint s_flush_errors = 0;
+static atomic_int s_last_flush_err = ESP_OK;
+
+/* Values live apart from the string, each one a blob: a small header, then the data (raw or LZ). */
+#define VALUE_NAMESPACE "values"
+#define VALUE_HEADER_LEN 3 /* format, original length (little endian u16) */
+#define VALUE_FORMAT_RAW 0
+#define VALUE_FORMAT_LZ 1
+
+/* One blob buffer for all value reads and writes, so nothing is allocated. */
+static uint8_t s_value_buf[VALUE_HEADER_LEN + STORAGE_VALUE_MAX_LEN];
+static StaticSemaphore_t s_value_lock_buf;
+static SemaphoreHandle_t s_value_lock;
 
 void storage_manager_init(void)
 {
@@ -36,6 +64,8 @@ void storage_manager_init(void)
     }
     ESP_ERROR_CHECK(ret);
 
+    s_value_lock = xSemaphoreCreateMutexStatic(&s_value_lock_buf);
+
     /* Once NVS is good, load the previously saved string (if any). */
     nvs_handle_t nvs_handle;
     esp_err_t err = nvs_open(STRING_NAMESPACE, NVS_READONLY, &nvs_handle);
@@ -66,27 +96,63 @@ void storage_manager_init(void)
     nvs_close(nvs_handle);
 }
 
-const char *storage_manager_get_string(void)
+void storage_manager_get_string(char *buf, size_t buf_size)
 {
-    return s_stored_string;
+    if (buf_size == 0)
+    {
+        return;
+    }
+    /* Copy under the lock, so a save on another task never hands out half of each string. */
+    portENTER_CRITICAL(&s_lock);
+    strncpy(buf, s_stored_string, buf_size - 1);
+    portEXIT_CRITICAL(&s_lock);
+    buf[buf_size - 1] = '\0';
 }
 
-void storage_manager_save_string(const char *value)
+uint32_t storage_manager_flush_errors(void)
+{
+    return atomic_load(&s_flush_errors);
+}
+
+esp_err_t storage_manager_last_flush_error(void)
+{
+    return atomic_load(&s_last_flush_err);
+}
+
+/*
+ * Write the RAM copy to flash. Runs on an executor worker, so HTTP handlers
+ * and the serial task never wait for an NVS commit. An empty string means
+ * "deleted" and erases the key.
+ */
+static esp_err_t storage_write_nvs(const char *value)
 {
     nvs_handle_t nvs_handle;
     esp_err_t err = nvs_open(STRING_NAMESPACE, NVS_READWRITE, &nvs_handle);
     if (err != ESP_OK)
     {
         ESP_LOGE(TAG, "Failed to open NVS for writing: %s", esp_err_to_name(err));
-        return;
+        return err;
     }
 
-    err = nvs_set_str(nvs_handle, STRING_KEY, value);
+    if (value[0] == '\0')
+    {
+        err = nvs_erase_key(nvs_handle, STRING_KEY);
+        if (err == ESP_ERR_NVS_NOT_FOUND)
+        {
+            ESP_LOGI(TAG, "String key not found in NVS, nothing to delete");
+            nvs_close(nvs_handle);
+            return ESP_OK;
+        }
+    }
+    else
+    {
+        err = nvs_set_str(nvs_handle, STRING_KEY, value);
+    }
     if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to set string in NVS: %s", esp_err_to_name(err));
+        ESP_LOGE(TAG, "Failed to update string in NVS: %s", esp_err_to_name(err));
         nvs_close(nvs_handle);
-        return;
+        return err;
     }
 
     err = nvs_commit(nvs_handle);
@@ -94,48 +160,199 @@ void storage_manager_save_string(const char *value)
     {
         ESP_LOGE(TAG, "Failed to commit NVS: %s", esp_err_to_name(err));
     }
+    else if (value[0] == '\0')
+    {
+        ESP_LOGI(TAG, "String deleted from NVS");
+    }
     else
     {
-        strncpy(s_stored_string, value, STRING_MAX_LEN - 1);
-        s_stored_string[STRING_MAX_LEN - 1] = '\0';
-        ESP_LOGI(TAG, "String saved to NVS: '%s'", s_stored_string);
+        ESP_LOGI(TAG, "String saved to NVS: '%s'", value);
     }
 
     nvs_close(nvs_handle);
+    return err;
+}
+
+/*
+ * Executor job: keep writing until the RAM copy stops changing.
+ * s_flush_scheduled makes sure only one of these runs at a time, so an
+ * older value can never be committed after a newer one.
+ */
+static int storage_flush_job(void *arg)
+{
+    (void)arg;
+    char value[STRING_MAX_LEN];
+    esp_err_t err = ESP_OK;
+
+    for (;;)
+    {
+        while (atomic_exchange(&s_dirty, false))
+        {
+            portENTER_CRITICAL(&s_lock);
+            memcpy(value, s_stored_string, sizeof(value));
+            portEXIT_CRITICAL(&s_lock);
+            err = storage_write_nvs(value);
+            atomic_store(&s_last_flush_err, err);
+            if (err != ESP_OK)
+            {
+                atomic_fetch_add(&s_flush_errors, 1);
+            }
+        }
+
+        atomic_store(&s_flush_scheduled, false);
+        /* A save that raced with the store above may have skipped scheduling. */
+        if (!atomic_load(&s_dirty) || atomic_exchange(&s_flush_scheduled, true))
+        {
+            return err;
+        }
+    }
+}
+
+/* Update the RAM copy now, and have the flash write done in the background. */
+static void storage_update(const char *value)
+{
+    portENTER_CRITICAL(&s_lock);
+    strncpy(s_stored_string, value, STRING_MAX_LEN - 1);
+    s_stored_string[STRING_MAX_LEN - 1] = '\0';
+    portEXIT_CRITICAL(&s_lock);
+
+    atomic_store(&s_dirty, true);
+    if (atomic_exchange(&s_flush_scheduled, true))
+    {
+        return; /* a flush is already queued or running and will pick this up */
+    }
+    if (executor_submit(EXECUTOR_PRIO_NORMAL, storage_flush_job, NULL, NULL, NULL) != ESP_OK)
+    {
+        storage_flush_job(NULL); /* executor not running or full: write it ourselves */
+    }
+}
+
+void storage_manager_save_string(const char *value)
+{
+    storage_update(value);
 }
 
 void storage_manager_delete_string(void)
 {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(STRING_NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK)
+    storage_update("");
+}
+
+/* ======================= VALUE STORAGE ======================= */
+
+esp_err_t storage_manager_set_value(const char *key, const void *data, size_t len, uint32_t flags)
+{
+    if (len == 0 || len > STORAGE_VALUE_MAX_LEN)
     {
-        ESP_LOGE(TAG, "Failed to open NVS for deleting: %s", esp_err_to_name(err));
-        return;
+        return ESP_ERR_INVALID_SIZE;
     }
 
-    err = nvs_erase_key(nvs_handle, STRING_KEY);
-    if (err == ESP_ERR_NVS_NOT_FOUND)
+    xSemaphoreTake(s_value_lock, portMAX_DELAY);
+
+    /* Only keep the compressed form if it is actually smaller. */
+    size_t stored_len = 0;
+    uint8_t format = VALUE_FORMAT_RAW;
+    if (flags & STORAGE_VALUE_COMPRESS)
     {
-        ESP_LOGI(TAG, "String key not found in NVS, nothing to delete");
+        stored_len = storage_lz_compress(data, len, &s_value_buf[VALUE_HEADER_LEN], len - 1);
+        format = stored_len != 0 ? VALUE_FORMAT_LZ : VALUE_FORMAT_RAW;
     }
-    else if (err != ESP_OK)
+    if (format == VALUE_FORMAT_RAW)
     {
-        ESP_LOGE(TAG, "Failed to erase key from NVS: %s", esp_err_to_name(err));
+        memcpy(&s_value_buf[VALUE_HEADER_LEN], data, len);
+        stored_len = len;
+    }
+    s_value_buf[0] = format;
+    s_value_buf[1] = (uint8_t)(len & 0xFF);
+    s_value_buf[2] = (uint8_t)(len >> 8);
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(VALUE_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err == ESP_OK)
+    {
+        err = nvs_set_blob(nvs_handle, key, s_value_buf, VALUE_HEADER_LEN + stored_len);
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(nvs_handle);
+        }
         nvs_close(nvs_handle);
-        return;
+    }
+    xSemaphoreGive(s_value_lock);
+
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to save value '%s': %s", key, esp_err_to_name(err));
     }
     else
     {
-        ESP_LOGI(TAG, "String deleted from NVS");
+        ESP_LOGI(TAG, "Value '%s' saved: %u bytes, %u in flash", key, (unsigned)len, (unsigned)stored_len);
     }
+    return err;
+}
 
-    err = nvs_commit(nvs_handle);
+esp_err_t storage_manager_get_value(const char *key, void *buf, size_t buf_size, size_t *out_len)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(VALUE_NAMESPACE, NVS_READONLY, &nvs_handle);
     if (err != ESP_OK)
     {
-        ESP_LOGE(TAG, "Failed to commit NVS after erase: %s", esp_err_to_name(err));
+        return err; /* ESP_ERR_NVS_NOT_FOUND until the first value is saved */
     }
 
+    xSemaphoreTake(s_value_lock, portMAX_DELAY);
+
+    size_t blob_len = sizeof(s_value_buf);
+    err = nvs_get_blob(nvs_handle, key, s_value_buf, &blob_len);
+    nvs_close(nvs_handle);
+
+    size_t len = 0;
+    if (err == ESP_OK && blob_len < VALUE_HEADER_LEN)
+    {
+        err = ESP_ERR_INVALID_STATE;
+    }
+    if (err == ESP_OK)
+    {
+        len = (size_t)s_value_buf[1] | (size_t)s_value_buf[2] << 8;
+        *out_len = len;
+        if (len > buf_size)
+        {
+            err = ESP_ERR_NVS_INVALID_LENGTH;
+        }
+    }
+    if (err == ESP_OK)
+    {
+        const uint8_t *stored = &s_value_buf[VALUE_HEADER_LEN];
+        size_t stored_len = blob_len - VALUE_HEADER_LEN;
+        if (s_value_buf[0] == VALUE_FORMAT_RAW && stored_len == len)
+        {
+            memcpy(buf, stored, len);
+        }
+        else if (s_value_buf[0] != VALUE_FORMAT_LZ || storage_lz_decompress(stored, stored_len, buf, len) != len)
+        {
+            err = ESP_ERR_INVALID_STATE;
+        }
+    }
+    xSemaphoreGive(s_value_lock);
+
+    if (err == ESP_ERR_INVALID_STATE)
+    {
+        ESP_LOGE(TAG, "Value '%s' in NVS is corrupt", key);
+    }
+    return err;
+}
+
+esp_err_t storage_manager_delete_value(const char *key)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(VALUE_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+    err = nvs_erase_key(nvs_handle, key);
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(nvs_handle);
+    }
     nvs_close(nvs_handle);
-    s_stored_string[0] = '\0';
+    return err;
 }
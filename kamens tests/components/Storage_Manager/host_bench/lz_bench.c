@@ -0,0 +1,213 @@
+/* ======================= STORAGE LZ HOST BENCHMARK ======================= */
+/*
+ * Compression ratio, CPU time per KB and NVS usage of storage_lz on a few
+ * payloads like the ones Storage_Manager stores, one JSON line each.
+ *
+ * NVS usage is what storage_manager_set_value() would take: the 3 byte
+ * value header plus the data as one blob, which NVS keeps as an index
+ * entry, a data header entry and one 32 byte entry per started 32 bytes.
+ * A 4 KB page holds 126 entries.
+ *
+ * Also round-trips random and truncated inputs, and exits non-zero if the
+ * codec ever returns something other than the original bytes.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "storage_lz.h"
+
+#define VALUE_HEADER_LEN 3
+#define NVS_ENTRY_SIZE 32
+#define NVS_ENTRIES_PER_PAGE 126
+#define MAX_PAYLOAD 4096
+#define ROUNDS 2000
+
+typedef struct
+{
+    const char *name;
+    char data[MAX_PAYLOAD];
+    size_t len;
+} payload_t;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static size_t nvs_entries(size_t value_len)
+{
+    return 2 + (VALUE_HEADER_LEN + value_len + NVS_ENTRY_SIZE - 1) / NVS_ENTRY_SIZE;
+}
+
+/* xorshift, so runs are repeatable */
+static uint32_t s_rng = 0x12345678;
+static uint32_t rng(void)
+{
+    s_rng ^= s_rng << 13;
+    s_rng ^= s_rng >> 17;
+    s_rng ^= s_rng << 5;
+    return s_rng;
+}
+
+static void make_config_json(payload_t *p)
+{
+    p->name = "config json";
+    p->len = 0;
+    p->len += (size_t)snprintf(p->data + p->len, MAX_PAYLOAD - p->len,
+                               "{\n  \"device\": {\"name\": \"ESP-SKYNET\", \"version\": \"1.4.2\", \"led_gpio\": 2},\n"
+                               "  \"wifi\": {\"ssid\": \"workshop-2g\", \"retries\": 5, \"power_save\": \"min_modem\"},\n"
+                               "  \"http\": {\"port\": 80, \"max_sockets\": 7, \"cors\": false},\n"
+                               "  \"schedule\": [\n");
+    for (int i = 0; i < 16; i++)
+    {
+        p->len += (size_t)snprintf(p->data + p->len, MAX_PAYLOAD - p->len,
+                                   "    {\"id\": %d, \"enabled\": %s, \"time\": \"%02d:%02d\", \"action\": \"led_set\", "
+                                   "\"args\": {\"state\": %s}},\n",
+                                   i, (i % 3) ? "true" : "false", 6 + i, (i * 7) % 60, (i & 1) ? "true" : "false");
+    }
+    p->len += (size_t)snprintf(p->data + p->len, MAX_PAYLOAD - p->len, "    {\"id\": 16, \"enabled\": false}\n  ]\n}\n");
+}
+
+static void make_minified_json(payload_t *p, const payload_t *pretty)
+{
+    p->name = "config json minified";
+    p->len = 0;
+    for (size_t i = 0; i < pretty->len; i++)
+    {
+        char c = pretty->data[i];
+        if (c != ' ' && c != '\n')
+        {
+            p->data[p->len++] = c;
+        }
+    }
+}
+
+static void make_text(payload_t *p)
+{
+    static const char *words[] = {"led", "on", "off", "storage", "saved", "wifi", "connected", "retry",
+                                  "http", "request", "the", "to", "from", "value", "flash", "ok"};
+    p->name = "log text";
+    p->len = 0;
+    while (p->len < 1500)
+    {
+        p->len += (size_t)snprintf(p->data + p->len, MAX_PAYLOAD - p->len, "%s%s", words[rng() % 16],
+                                   (rng() % 9) ? " " : ".\n");
+    }
+}
+
+static void make_short_string(payload_t *p)
+{
+    p->name = "short string";
+    p->len = (size_t)snprintf(p->data, MAX_PAYLOAD, "hello-from-test");
+}
+
+static void make_random(payload_t *p)
+{
+    p->name = "random bytes";
+    p->len = 1024;
+    for (size_t i = 0; i < p->len; i++)
+    {
+        p->data[i] = (char)rng();
+    }
+}
+
+static int bench(const payload_t *p)
+{
+    static uint8_t packed[MAX_PAYLOAD];
+    static uint8_t unpacked[MAX_PAYLOAD];
+    const uint8_t *in = (const uint8_t *)p->data;
+
+    /* Same rule as Storage_Manager: only keep the compressed form if it is smaller. */
+    size_t packed_len = storage_lz_compress(in, p->len, packed, p->len - 1);
+    int compressed = packed_len != 0;
+
+    uint64_t start = now_ns();
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        storage_lz_compress(in, p->len, packed, sizeof(packed));
+    }
+    uint64_t compress_ns = (now_ns() - start) / ROUNDS;
+    size_t full_len = storage_lz_compress(in, p->len, packed, sizeof(packed));
+
+    start = now_ns();
+    size_t out_len = 0;
+    for (int r = 0; r < ROUNDS; r++)
+    {
+        out_len = storage_lz_decompress(packed, full_len, unpacked, sizeof(unpacked));
+    }
+    uint64_t decompress_ns = (now_ns() - start) / ROUNDS;
+
+    int ok = out_len == p->len && memcmp(unpacked, in, p->len) == 0;
+    size_t stored = compressed ? packed_len : p->len;
+    double kb = (double)p->len / 1024.0;
+    printf("{\"payload\": \"%s\", \"bytes\": %zu, \"stored_bytes\": %zu, \"ratio\": %.2f, "
+           "\"compress_ns_per_kb\": %.0f, \"decompress_ns_per_kb\": %.0f, "
+           "\"nvs_entries_raw\": %zu, \"nvs_entries_stored\": %zu, \"nvs_pages_stored\": %.3f, \"round_trip\": %s}\n",
+           p->name, p->len, stored, (double)p->len / (double)stored, (double)compress_ns / kb,
+           (double)decompress_ns / kb, nvs_entries(p->len), nvs_entries(stored),
+           (double)nvs_entries(stored) / NVS_ENTRIES_PER_PAGE, ok ? "true" : "false");
+    return ok ? 0 : 1;
+}
+
+/* Random inputs with runs and repeats, every length up to 1.5 KB; plus corrupt input must not overrun. */
+static int fuzz(void)
+{
+    static uint8_t in[1536];
+    static uint8_t packed[2048];
+    static uint8_t out[1536];
+    int failures = 0;
+
+    for (size_t len = 1; len <= sizeof(in); len++)
+    {
+        for (size_t i = 0; i < len; i++)
+        {
+            uint32_t r = rng();
+            in[i] = (r & 3) == 0 && i >= 40 ? in[i - 1 - (r >> 8) % 40] : (uint8_t)('a' + (r >> 16) % 4);
+        }
+        size_t packed_len = storage_lz_compress(in, len, packed, sizeof(packed));
+        if (packed_len == 0 || storage_lz_decompress(packed, packed_len, out, len) != len ||
+            memcmp(in, out, len) != 0)
+        {
+            printf("round trip failed at length %zu\n", len);
+            failures++;
+        }
+        /* Too small an output buffer and truncated input are errors, never overruns. */
+        if (len > 1 && storage_lz_decompress(packed, packed_len, out, len - 1) != STORAGE_LZ_ERROR)
+        {
+            printf("short output buffer not detected at length %zu\n", len);
+            failures++;
+        }
+        size_t cut = storage_lz_decompress(packed, packed_len / 2, out, len);
+        if (cut != STORAGE_LZ_ERROR && cut > len)
+        {
+            printf("truncated input overran at length %zu\n", len);
+            failures++;
+        }
+    }
+    printf("{\"fuzz_lengths\": %zu, \"failures\": %d}\n", sizeof(in), failures);
+    return failures;
+}
+
+int main(void)
+{
+    static payload_t payloads[5];
+    make_config_json(&payloads[0]);
+    make_minified_json(&payloads[1], &payloads[0]);
+    make_text(&payloads[2]);
+    make_short_string(&payloads[3]);
+    make_random(&payloads[4]);
+
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(payloads) / sizeof(payloads[0]); i++)
+    {
+        failures += bench(&payloads[i]);
+    }
+    failures += fuzz();
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -1,12 +1,54 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sdkconfig.h"
 #include "esp_err.h"
 
 /* ======================= STRING STORAGE HEADER ======================= */
 /*
  * This header lets other files save/read/delete the short string in flash.
+ * Save and delete update the RAM copy right away and return; the flash
+ * write happens shortly after on an executor worker. A write that fails
+ * there is logged and counted, see storage_manager_flush_errors().
  */
+#define STORAGE_STRING_MAX_LEN 64 /* including the terminating NUL */
+
 void storage_manager_init(void);
-const char *storage_manager_get_string(void);
+
+/* Copy the string (truncated to buf_size - 1 characters) into buf. */
+void storage_manager_get_string(char *buf, size_t buf_size);
 void storage_manager_save_string(const char *value);
 void storage_manager_delete_string(void);
+
+/*
+ * Number of background flash writes that failed since boot, and the error
+ * of the most recent flush (ESP_OK once a later flush succeeded).
+ */
+uint32_t storage_manager_flush_errors(void);
+esp_err_t storage_manager_last_flush_error(void);
+
+/* ======================= VALUE STORAGE ======================= */
+/*
+ * Bigger values (config documents, ...) under their own key, up to
+ * STORAGE_VALUE_MAX_LEN bytes. There is no RAM copy: set and delete write
+ * to flash before they return, get reads it.
+ *
+ * With STORAGE_VALUE_COMPRESS the value is LZ compressed (storage_lz.h)
+ * when that makes it smaller. Each stored value records whether it was,
+ * so reads need no flag and always give back the original bytes.
+ */
+#define STORAGE_VALUE_MAX_LEN CONFIG_STORAGE_MANAGER_VALUE_MAX_LEN
+
+#define STORAGE_VALUE_COMPRESS (1u << 0)
+
+esp_err_t storage_manager_set_value(const char *key, const void *data, size_t len, uint32_t flags);
+
+/*
+ * Copy the value into buf. *out_len is set to its length; if buf_size is
+ * too small nothing is copied and ESP_ERR_NVS_INVALID_LENGTH is returned.
+ */
+esp_err_t storage_manager_get_value(const char *key, void *buf, size_t buf_size, size_t *out_len);
+
+esp_err_t storage_manager_delete_value(const char *key);
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ======================= STORAGE LZ CODEC HEADER ======================= */
+/*
+ * Small LZ77 (LZSS) codec used by Storage_Manager for compressed values.
+ *
+ * The stream is groups of one flag byte followed by up to 8 items, flag
+ * bit i (LSB first) telling whether item i is a literal byte (0) or a
+ * 2 byte back-reference (1): 10 bit offset - 1, 6 bit length - 3.
+ * So the window is a fixed 1 KB and a match is 3..66 bytes.
+ *
+ * Neither side allocates. The compressor keeps a 512 byte hash table on
+ * the stack; the decompressor uses the caller's output buffer as its
+ * window, so it needs no state at all.
+ *
+ * Plain C with no ESP-IDF dependency, so host_bench/ can build it on a PC.
+ */
+
+#define STORAGE_LZ_WINDOW 1024
+#define STORAGE_LZ_MIN_MATCH 3
+#define STORAGE_LZ_MAX_MATCH 66
+
+/* Largest input the compressor takes (positions are kept as uint16_t). */
+#define STORAGE_LZ_MAX_INPUT (UINT16_MAX - 1)
+
+#define STORAGE_LZ_ERROR SIZE_MAX
+
+/*
+ * Compress in[0..in_len) into out. Returns the compressed length, or 0
+ * if in_len is 0 or too large, or the result does not fit in out_size.
+ * Pass out_size < in_len to give up as soon as compressing does not pay.
+ */
+size_t storage_lz_compress(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_size);
+
+/*
+ * Decompress in[0..in_len) into out. Returns the decompressed length, or
+ * STORAGE_LZ_ERROR if the input is corrupt or out_size is too small.
+ */
+size_t storage_lz_decompress(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_size);
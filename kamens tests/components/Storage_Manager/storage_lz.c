@@ -0,0 +1,150 @@
+/* ======================= STORAGE LZ CODEC ======================= */
+/*
+ * See storage_lz.h for the stream format.
+ *
+ * The compressor is greedy: at each position it looks up the last place
+ * the next 3 bytes were seen (one hash slot, no chains) and takes that
+ * match if it is close enough. Good enough for JSON and text, and the
+ * cost stays linear in the input.
+ */
+
+#include "storage_lz.h"
+
+#include <string.h>
+
+#define HASH_BITS 8
+
+static inline uint32_t hash3(const uint8_t *p)
+{
+    uint32_t v = (uint32_t)p[0] << 16 | (uint32_t)p[1] << 8 | p[2];
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+size_t storage_lz_compress(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_size)
+{
+    uint16_t head[1 << HASH_BITS]; /* position + 1 of the last 3-byte sequence per hash, 0 = none */
+    size_t ip = 0;
+    size_t op = 0;
+    size_t flag_pos = 0;
+    unsigned flag_bit = 8;
+
+    if (in_len == 0 || in_len > STORAGE_LZ_MAX_INPUT)
+    {
+        return 0;
+    }
+    memset(head, 0, sizeof(head));
+
+    while (ip < in_len)
+    {
+        if (flag_bit == 8)
+        {
+            if (op >= out_size)
+            {
+                return 0;
+            }
+            flag_pos = op++;
+            out[flag_pos] = 0;
+            flag_bit = 0;
+        }
+
+        size_t match_len = 0;
+        size_t match_off = 0;
+        if (ip + STORAGE_LZ_MIN_MATCH <= in_len)
+        {
+            uint32_t h = hash3(&in[ip]);
+            size_t candidate = head[h];
+            head[h] = (uint16_t)(ip + 1);
+            if (candidate != 0 && ip - (candidate - 1) <= STORAGE_LZ_WINDOW)
+            {
+                candidate--;
+                size_t max_len = in_len - ip;
+                if (max_len > STORAGE_LZ_MAX_MATCH)
+                {
+                    max_len = STORAGE_LZ_MAX_MATCH;
+                }
+                size_t n = 0;
+                while (n < max_len && in[candidate + n] == in[ip + n])
+                {
+                    n++;
+                }
+                if (n >= STORAGE_LZ_MIN_MATCH)
+                {
+                    match_len = n;
+                    match_off = ip - candidate;
+                }
+            }
+        }
+
+        if (match_len != 0)
+        {
+            if (op + 2 > out_size)
+            {
+                return 0;
+            }
+            out[op++] = (uint8_t)(match_off - 1);
+            out[op++] = (uint8_t)(((match_off - 1) >> 8) << 6 | (match_len - STORAGE_LZ_MIN_MATCH));
+            out[flag_pos] |= (uint8_t)(1u << flag_bit);
+
+            /* Remember the positions inside the match too, or repeats of them are missed. */
+            for (size_t k = ip + 1; k < ip + match_len && k + STORAGE_LZ_MIN_MATCH <= in_len; k++)
+            {
+                head[hash3(&in[k])] = (uint16_t)(k + 1);
+            }
+            ip += match_len;
+        }
+        else
+        {
+            if (op >= out_size)
+            {
+                return 0;
+            }
+            out[op++] = in[ip++];
+        }
+        flag_bit++;
+    }
+
+    return op;
+}
+
+size_t storage_lz_decompress(const uint8_t *in, size_t in_len, uint8_t *out, size_t out_size)
+{
+    size_t ip = 0;
+    size_t op = 0;
+
+    while (ip < in_len)
+    {
+        uint8_t flags = in[ip++];
+        for (unsigned bit = 0; bit < 8 && ip < in_len; bit++)
+        {
+            if (flags & (1u << bit))
+            {
+                if (ip + 2 > in_len)
+                {
+                    return STORAGE_LZ_ERROR;
+                }
+                size_t off = ((size_t)in[ip] | (size_t)(in[ip + 1] >> 6) << 8) + 1;
+                size_t len = (size_t)(in[ip + 1] & 0x3F) + STORAGE_LZ_MIN_MATCH;
+                ip += 2;
+                if (off > op || len > out_size - op)
+                {
+                    return STORAGE_LZ_ERROR;
+                }
+                /* Byte by byte: the source may overlap what is being written (runs). */
+                for (size_t k = 0; k < len; k++, op++)
+                {
+                    out[op] = out[op - off];
+                }
+            }
+            else
+            {
+                if (op >= out_size)
+                {
+                    return STORAGE_LZ_ERROR;
+                }
+                out[op++] = in[ip++];
+            }
+        }
+    }
+
+    return op;
+}
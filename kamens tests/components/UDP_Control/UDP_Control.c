@@ -0,0 +1,131 @@
+/* ======================= UDP LED FAST PATH ======================= */
+/*
+ * This file listens for tiny binary LED commands over UDP.
+ * It uses the lwIP "raw" API, so the receive callback runs inside the
+ * lwIP (tcpip) thread itself: no socket, no extra task, no queue hop.
+ * The reply is written back into the pbuf we received, so we never copy
+ * the frame into a buffer of our own. On ESP-IDF the WiFi driver hands
+ * us PBUF_REF pbufs, though, so udp_sendto() still allocates one small
+ * header pbuf per reply from the lwIP pool and frees it after sending.
+ */
+
+#include "UDP_Control.h"
+
+#include <stdint.h>
+
+#include "sdkconfig.h"
+
+#include "esp_log.h"
+#include "esp_netif.h"
+
+#include "lwip/pbuf.h"
+#include "lwip/udp.h"
+
+#include "LED_Controler.h"
+
+static const char *TAG = "udp_ctrl";
+
+#ifndef CONFIG_UDP_CONTROL_PORT
+#define CONFIG_UDP_CONTROL_PORT 3333
+#endif
+
+/* The one and only UDP control block. Only touched from the lwIP thread. */
+static struct udp_pcb *s_pcb = NULL;
+
+/* Work out the reply opcode for one request opcode, applying it to the LED. */
+static uint8_t udp_control_apply(uint8_t opcode)
+{
+    int state;
+    switch (opcode)
+    {
+    case UDP_CONTROL_OP_OFF:
+        led_control_set(0);
+        state = 0;
+        break;
+    case UDP_CONTROL_OP_ON:
+        led_control_set(1);
+        state = 1;
+        break;
+    case UDP_CONTROL_OP_TOGGLE:
+        state = led_control_toggle();
+        break;
+    case UDP_CONTROL_OP_QUERY:
+        state = led_control_is_on();
+        break;
+    default:
+        return UDP_CONTROL_REPLY_NACK;
+    }
+    return UDP_CONTROL_REPLY_ACK | (uint8_t)state;
+}
+
+/* Called by lwIP in the tcpip thread for every datagram on our port. */
+static void udp_control_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                             const ip_addr_t *addr, u16_t port)
+{
+    (void)arg;
+
+    uint8_t frame[UDP_CONTROL_FRAME_LEN];
+    if (p->tot_len != UDP_CONTROL_FRAME_LEN ||
+        pbuf_copy_partial(p, frame, sizeof(frame), 0) != sizeof(frame) ||
+        frame[0] != 'L' || frame[1] != 'D' || frame[2] != UDP_CONTROL_VERSION)
+    {
+        pbuf_free(p);
+        return;
+    }
+
+    frame[3] = udp_control_apply(frame[3]);
+
+    /* Reuse the received pbuf for the reply; it still has header room. */
+    if (pbuf_take(p, frame, sizeof(frame)) == ERR_OK)
+    {
+        udp_sendto(pcb, p, addr, port);
+    }
+    pbuf_free(p);
+}
+
+/*
+ * Runs in the tcpip thread, because raw API calls must not happen anywhere else.
+ * esp_netif_tcpip_exec() gets us there and waits for the result.
+ */
+static esp_err_t udp_control_bind(void *ctx)
+{
+    err_t *lwip_err = ctx;
+
+    if (s_pcb != NULL)
+    {
+        return ESP_OK;
+    }
+
+    struct udp_pcb *pcb = udp_new_ip_type(IPADDR_TYPE_ANY);
+    if (pcb == NULL)
+    {
+        *lwip_err = ERR_MEM;
+        return ESP_ERR_NO_MEM;
+    }
+
+    *lwip_err = udp_bind(pcb, IP_ANY_TYPE, CONFIG_UDP_CONTROL_PORT);
+    if (*lwip_err != ERR_OK)
+    {
+        udp_remove(pcb);
+        return ESP_FAIL;
+    }
+
+    udp_recv(pcb, udp_control_recv, NULL);
+    s_pcb = pcb;
+    return ESP_OK;
+}
+
+esp_err_t udp_control_start(void)
+{
+    err_t lwip_err = ERR_OK;
+
+    esp_err_t err = esp_netif_tcpip_exec(udp_control_bind, &lwip_err);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to bind UDP port %d (lwIP err %d)", CONFIG_UDP_CONTROL_PORT, lwip_err);
+        return err;
+    }
+
+    ESP_LOGI(TAG, "UDP LED fast path listening on port %d", CONFIG_UDP_CONTROL_PORT);
+    return ESP_OK;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "esp_err.h"
+
+/* ======================= UDP FAST PATH HEADER ======================= */
+/*
+ * A tiny binary UDP listener for LED commands, for when HTTP is too slow.
+ *
+ * Every packet is exactly 8 bytes:
+ *
+ *   byte 0..1  magic 'L' 'D'
+ *   byte 2     protocol version (UDP_CONTROL_VERSION)
+ *   byte 3     opcode (see below)
+ *   byte 4..7  sequence number, little endian, echoed back in the reply
+ *
+ * The reply has the same layout. Its opcode byte is UDP_CONTROL_REPLY_ACK
+ * ORed with the new LED state (0 or 1), or UDP_CONTROL_REPLY_NACK when the
+ * opcode was not understood. Packets with a wrong size, magic or version
+ * are dropped without a reply.
+ */
+#define UDP_CONTROL_FRAME_LEN 8
+#define UDP_CONTROL_VERSION 1
+
+#define UDP_CONTROL_OP_OFF 0x00
+#define UDP_CONTROL_OP_ON 0x01
+#define UDP_CONTROL_OP_TOGGLE 0x02
+#define UDP_CONTROL_OP_QUERY 0x03
+
+#define UDP_CONTROL_REPLY_ACK 0x80
+#define UDP_CONTROL_REPLY_NACK 0xFF
+
+/*
+ * Bind the listener on CONFIG_UDP_CONTROL_PORT.
+ * Safe to call more than once; later calls do nothing.
+ */
+esp_err_t udp_control_start(void);
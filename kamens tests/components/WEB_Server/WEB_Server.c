@@ -6,18 +6,31 @@
 
 #include "WEB_Server.h"
 
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
+#include "sdkconfig.h"
 #include "esp_log.h"
 #include "esp_http_server.h"
+#include "esp_timer.h"
 
 #include "LED_Controler.h"
 #include "Storage_Manager.h"
+#include "Command_Router.h"
+#include "Metrics_History.h"
 
 #include "esp_mac.h"
 
 static const char *TAG = "web";
 
+/* Generic command endpoint: /api/cmd/<name> runs any command from commands.json. */
+#define API_CMD_PREFIX "/api/cmd/"
+#define API_BODY_MAX 256
+#define API_RESPONSE_MAX 256
+
 /* Helper: send a simple HTTP response with plain text. */
 static esp_err_t send_text_response(httpd_req_t *req, const char *text)
 {
@@ -25,6 +38,77 @@ static esp_err_t send_text_response(httpd_req_t *req, const char *text)
     return httpd_resp_send(req, text, HTTPD_RESP_USE_STRLEN);
 }
 
+/* Helper: true if the header value starts with this media type (parameters like "; charset=" may follow). */
+static bool media_type_is(const char *value, const char *type)
+{
+    size_t n = strlen(type);
+    return strncasecmp(value, type, n) == 0 && (value[n] == '\0' || strchr(";, \t", value[n]) != NULL);
+}
+
+/* Helper: pick the command router format from a Content-Type / Accept header.
+ * Only the first media type matters, so a value longer than the buffer is
+ * fine: httpd still hands us its start, and that is all we compare. */
+static command_format_t header_format(httpd_req_t *req, const char *header, command_format_t fallback)
+{
+    char value[48];
+    esp_err_t err = httpd_req_get_hdr_value_str(req, header, value, sizeof(value));
+    if (err != ESP_OK && err != ESP_ERR_HTTPD_RESULT_TRUNC)
+    {
+        return fallback;
+    }
+    if (media_type_is(value, "application/json"))
+    {
+        return COMMAND_FORMAT_JSON;
+    }
+    if (media_type_is(value, "application/cbor"))
+    {
+        return COMMAND_FORMAT_CBOR;
+    }
+    if (media_type_is(value, "application/x-www-form-urlencoded"))
+    {
+        return COMMAND_FORMAT_FORM;
+    }
+    return fallback;
+}
+
+/* Helper: read the whole request body into buf ('\0' terminated). Sends the error response itself. */
+static esp_err_t receive_body(httpd_req_t *req, char *buf, size_t buf_size, size_t *len)
+{
+    int total_len = req->content_len;
+    int received = 0;
+
+    if (total_len >= (int)buf_size)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Request body too long");
+        return ESP_FAIL;
+    }
+
+    while (received < total_len)
+    {
+        int r = httpd_req_recv(req, buf + received, total_len - received);
+        if (r <= 0)
+        {
+            httpd_resp_send_500(req);
+            return ESP_FAIL;
+        }
+        received += r;
+    }
+
+    buf[received] = '\0';
+    *len = (size_t)received;
+    return ESP_OK;
+}
+
+/* Helper: turn a failed command into a 400 / 500 with a short reason. */
+static esp_err_t send_command_error(httpd_req_t *req, command_status_t status)
+{
+    httpd_err_code_t code = (status == COMMAND_ERR_FAILED || status == COMMAND_ERR_NO_SPACE)
+                                ? HTTPD_500_INTERNAL_SERVER_ERROR
+                                : HTTPD_400_BAD_REQUEST;
+    httpd_resp_send_err(req, code, command_router_status_name(status));
+    return ESP_FAIL;
+}
+
 /* ========== ROOT HANDLER ("/") ========== */
 static esp_err_t root_get_handler(httpd_req_t *req)
 {
@@ -54,10 +138,13 @@ static esp_err_t root_get_handler(httpd_req_t *req)
         "</body>\n"
         "</html>\n";
 
+    char stored[STORAGE_STRING_MAX_LEN];
+    storage_manager_get_string(stored, sizeof(stored));
+
     char response[768];
     snprintf(response, sizeof(response), html,
              led_control_is_on() ? "ON" : "OFF",
-             storage_manager_get_string()[0] ? storage_manager_get_string() : "(empty)");
+             stored[0] ? stored : "(empty)");
 
     httpd_resp_set_type(req, "text/html");
     return httpd_resp_send(req, response, HTTPD_RESP_USE_STRLEN);
@@ -69,19 +156,12 @@ static esp_err_t led_get_handler(httpd_req_t *req)
     char query[64];
     if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
     {
-        char state[8];
-        if (httpd_query_key_value(query, "state", state, sizeof(state)) == ESP_OK)
+        cmd_led_set_args_t args;
+        if (command_router_decode(CMD_LED_SET, COMMAND_FORMAT_FORM, query, strlen(query), &args) == COMMAND_OK)
         {
-            if (strcmp(state, "on") == 0)
-            {
-                led_control_set(1);
-                return send_text_response(req, "LED turned ON\n");
-            }
-            else if (strcmp(state, "off") == 0)
-            {
-                led_control_set(0);
-                return send_text_response(req, "LED turned OFF\n");
-            }
+            cmd_led_set_result_t result;
+            command_router_dispatch(CMD_LED_SET, &args, &result);
+            return send_text_response(req, result.state ? "LED turned ON\n" : "LED turned OFF\n");
         }
     }
     return send_text_response(req, "Use /led?state=on or /led?state=off\n");
@@ -90,11 +170,15 @@ static esp_err_t led_get_handler(httpd_req_t *req)
 /* ========== STRING GET HANDLER ("/string", GET) ========== */
 static esp_err_t string_get_handler(httpd_req_t *req)
 {
-    if (storage_manager_get_string()[0] == '\0')
+    cmd_string_get_args_t args = {0};
+    cmd_string_get_result_t result;
+    command_router_dispatch(CMD_STRING_GET, &args, &result);
+
+    if (result.value[0] == '\0')
     {
         return send_text_response(req, "(empty)\n");
     }
-    return send_text_response(req, storage_manager_get_string());
+    return send_text_response(req, result.value);
 }
 
 /* ========== STRING POST HANDLER ("/string", POST) ========== */
@@ -108,109 +192,337 @@ static esp_err_t string_post_handler(httpd_req_t *req)
         {
             if (strcmp(del, "1") == 0)
             {
-                storage_manager_delete_string();
+                cmd_string_delete_args_t args = {0};
+                cmd_string_delete_result_t result;
+                command_router_dispatch(CMD_STRING_DELETE, &args, &result);
                 return send_text_response(req, "String deleted\n");
             }
         }
     }
 
-    char buf[64];
-    int total_len = req->content_len;
-    int received = 0;
+    char buf[API_BODY_MAX];
+    size_t received;
+    if (receive_body(req, buf, sizeof(buf), &received) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+
+    /*
+     * JSON and form bodies go through the command router.
+     * A body without "value=" is the plain string itself, like before.
+     */
+    cmd_string_set_args_t args;
+    command_status_t status;
+    command_format_t format = header_format(req, "Content-Type", COMMAND_FORMAT_FORM);
 
-    if (total_len >= (int)sizeof(buf))
+    if (format != COMMAND_FORMAT_FORM || strncmp(buf, "value=", strlen("value=")) == 0)
+    {
+        status = command_router_decode(CMD_STRING_SET, format, buf, received, &args);
+    }
+    else if (received < sizeof(args.value))
+    {
+        memcpy(args.value, buf, received + 1);
+        status = COMMAND_OK;
+    }
+    else
+    {
+        status = COMMAND_ERR_TOO_LONG;
+    }
+
+    if (status == COMMAND_ERR_TOO_LONG)
     {
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "String too long");
         return ESP_FAIL;
     }
+    if (status != COMMAND_OK)
+    {
+        return send_command_error(req, status);
+    }
 
-    while (received < total_len)
+    cmd_string_set_result_t result;
+    command_router_dispatch(CMD_STRING_SET, &args, &result);
+    return send_text_response(req, "String saved\n");
+}
+
+/* ========== STRING DELETE HANDLER ("/string", DELETE) ========== */
+static esp_err_t string_delete_handler(httpd_req_t *req)
+{
+    cmd_string_delete_args_t args = {0};
+    cmd_string_delete_result_t result;
+    command_router_dispatch(CMD_STRING_DELETE, &args, &result);
+    return send_text_response(req, "String deleted\n");
+}
+
+/* ========== GENERIC COMMAND HANDLER ("/api/cmd/<name>", GET and POST) ========== */
+/*
+ * GET takes arguments from the query string, POST from the body
+ * (form, JSON or CBOR, chosen by Content-Type). The answer is JSON,
+ * or CBOR when the client sends "Accept: application/cbor".
+ */
+static esp_err_t api_cmd_handler(httpd_req_t *req)
+{
+    const char *name = req->uri + strlen(API_CMD_PREFIX);
+    const command_desc_t *cmd = command_router_find_by_name(name, strcspn(name, "?"));
+    if (cmd == NULL)
     {
-        int r = httpd_req_recv(req, buf + received, total_len - received);
-        if (r <= 0)
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Unknown command");
+        return ESP_FAIL;
+    }
+
+    char body[API_BODY_MAX];
+    size_t body_len = 0;
+    command_format_t in_format = COMMAND_FORMAT_FORM;
+
+    if (req->method == HTTP_POST)
+    {
+        if (receive_body(req, body, sizeof(body), &body_len) != ESP_OK)
         {
-            httpd_resp_send_500(req);
             return ESP_FAIL;
         }
-        received += r;
+        in_format = header_format(req, "Content-Type", COMMAND_FORMAT_FORM);
+    }
+    else if (httpd_req_get_url_query_str(req, body, sizeof(body)) == ESP_OK)
+    {
+        body_len = strlen(body);
     }
 
-    buf[received] = '\0';
+    command_format_t out_format = header_format(req, "Accept", COMMAND_FORMAT_JSON);
+    if (out_format == COMMAND_FORMAT_FORM)
+    {
+        out_format = COMMAND_FORMAT_JSON;
+    }
 
-    const char *value_prefix = "value=";
-    const size_t prefix_len = strlen(value_prefix);
-    const char *value_ptr = NULL;
+    char response[API_RESPONSE_MAX];
+    size_t response_len = 0;
+    command_status_t status = command_router_execute(cmd->id, in_format, body, body_len,
+                                                     out_format, response, sizeof(response), &response_len);
+    if (status != COMMAND_OK)
+    {
+        return send_command_error(req, status);
+    }
+
+    httpd_resp_set_type(req, out_format == COMMAND_FORMAT_CBOR ? "application/cbor" : "application/json");
+    return httpd_resp_send(req, response, (ssize_t)response_len);
+}
 
-    if (strncmp(buf, value_prefix, prefix_len) == 0)
+#if CONFIG_METRICS_HISTORY_ENABLE
+/* ========== METRICS HISTORY HANDLER ("/api/history", GET) ========== */
+/*
+ * /api/history?from=<s>&to=<s>&tier=1s|1m|10m, times in seconds since boot,
+ * or /api/history?last=<s> for the last <s> seconds. Without tier, the
+ * finest tier that still reaches back to `from` is used.
+ *
+ * Rows are decoded HISTORY_ROWS_PER_CHUNK at a time and sent as chunks,
+ * so the reply can be any length and the history lock is only held while
+ * a few rows are copied out.
+ */
+#define HISTORY_ROWS_PER_CHUNK 16
+
+static uint32_t query_u32(const char *query, const char *key, uint32_t fallback)
+{
+    char value[12];
+    if (httpd_query_key_value(query, key, value, sizeof(value)) != ESP_OK)
     {
-        value_ptr = buf + prefix_len;
+        return fallback;
     }
-    else
+    return (uint32_t)strtoul(value, NULL, 10);
+}
+
+static metrics_tier_t pick_tier(uint32_t from)
+{
+    metrics_tier_t best = METRICS_TIER_1S;
+    uint32_t best_first = UINT32_MAX;
+    for (int tier = 0; tier < METRICS_TIER_COUNT; tier++)
     {
-        value_ptr = buf;
+        uint32_t first, last;
+        if (!metrics_history_span(tier, &first, &last))
+        {
+            continue;
+        }
+        if (first <= from)
+        {
+            return tier;
+        }
+        if (first < best_first)
+        {
+            best = tier;
+            best_first = first;
+        }
     }
+    return best; /* nothing reaches back that far: the tier that reaches back furthest */
+}
 
-    storage_manager_save_string(value_ptr);
-    return send_text_response(req, "String saved\n");
+static esp_err_t history_get_handler(httpd_req_t *req)
+{
+    uint32_t now = metrics_history_now();
+    uint32_t from = 0;
+    uint32_t to = now;
+    int tier = -1;
+
+    char query[96];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+    {
+        uint32_t last = query_u32(query, "last", 0);
+        from = last ? (last < now ? now - last : 0) : query_u32(query, "from", 0);
+        to = query_u32(query, "to", now);
+
+        char name[8];
+        if (httpd_query_key_value(query, "tier", name, sizeof(name)) == ESP_OK)
+        {
+            for (int t = 0; t < METRICS_TIER_COUNT; t++)
+            {
+                if (strcmp(name, metrics_history_tier_name(t)) == 0)
+                {
+                    tier = t;
+                }
+            }
+            if (tier < 0)
+            {
+                httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "tier must be 1s, 1m or 10m");
+                return ESP_FAIL;
+            }
+        }
+    }
+    if (tier < 0)
+    {
+        tier = pick_tier(from);
+    }
+
+    char out[512];
+    int len = snprintf(out, sizeof(out), "{\"now\":%lu,\"tier\":\"%s\",\"interval_s\":%lu,\"metrics\":[",
+                       (unsigned long)now, metrics_history_tier_name(tier),
+                       (unsigned long)metrics_history_tier_seconds(tier));
+    for (int m = 0; m < METRIC_COUNT; m++)
+    {
+        len += snprintf(out + len, sizeof(out) - len, "%s\"%s\"", m ? "," : "", metrics_history_metric_name(m));
+    }
+    len += snprintf(out + len, sizeof(out) - len, "],\"rows\":[");
+
+    httpd_resp_set_type(req, "application/json");
+    metrics_row_t rows[HISTORY_ROWS_PER_CHUNK];
+    bool first_row = true;
+    size_t count;
+    do
+    {
+        count = metrics_history_query(tier, from, to, rows, HISTORY_ROWS_PER_CHUNK);
+        for (size_t i = 0; i < count; i++)
+        {
+            /* Worst case row: 11 digit time + 5 x 11 digit values + punctuation, well under 96 bytes */
+            if (len > (int)sizeof(out) - 96)
+            {
+                if (httpd_resp_send_chunk(req, out, len) != ESP_OK)
+                {
+                    return ESP_FAIL;
+                }
+                len = 0;
+            }
+            len += snprintf(out + len, sizeof(out) - len, "%s[%lu", first_row ? "" : ",",
+                            (unsigned long)rows[i].t);
+            for (int m = 0; m < METRIC_COUNT; m++)
+            {
+                len += snprintf(out + len, sizeof(out) - len, ",%ld", (long)rows[i].values[m]);
+            }
+            len += snprintf(out + len, sizeof(out) - len, "]");
+            first_row = false;
+        }
+        if (count > 0)
+        {
+            from = rows[count - 1].t + 1;
+        }
+    } while (count == HISTORY_ROWS_PER_CHUNK && from != 0 && from <= to);
+
+    size_t stored_rows, stored_bytes;
+    metrics_history_usage(tier, &stored_rows, &stored_bytes);
+    if (len > (int)sizeof(out) - 96)
+    {
+        if (httpd_resp_send_chunk(req, out, len) != ESP_OK)
+        {
+            return ESP_FAIL;
+        }
+        len = 0;
+    }
+    len += snprintf(out + len, sizeof(out) - len,
+                    "],\"stored_rows\":%u,\"stored_bytes\":%u,\"dropped_samples\":%lu}",
+                    (unsigned)stored_rows, (unsigned)stored_bytes,
+                    (unsigned long)metrics_history_dropped_samples());
+    if (httpd_resp_send_chunk(req, out, len) != ESP_OK)
+    {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
 }
 
-/* ========== STRING DELETE HANDLER ("/string", DELETE) ========== */
-static esp_err_t string_delete_handler(httpd_req_t *req)
+/* Runs the route's real handler (registered as user_ctx) and records the request's latency. */
+static esp_err_t timed_handler(httpd_req_t *req)
 {
-    storage_manager_delete_string();
-    return send_text_response(req, "String deleted\n");
+    const httpd_uri_t *route = req->user_ctx;
+    req->user_ctx = route->user_ctx;
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = route->handler(req);
+    metrics_history_note_request((uint32_t)(esp_timer_get_time() - start));
+    return ret;
 }
+#endif
 
-void web_server_start(void)
+/* Every endpoint the server serves. Also handed out to the benchmarks so they can call the handlers directly. */
+static const httpd_uri_t s_uri_handlers[] = {
+    {.uri = "/", .method = HTTP_GET, .handler = root_get_handler, .user_ctx = NULL},
+    {.uri = "/led", .method = HTTP_GET, .handler = led_get_handler, .user_ctx = NULL},
+    {.uri = "/string", .method = HTTP_GET, .handler = string_get_handler, .user_ctx = NULL},
+    {.uri = "/string", .method = HTTP_POST, .handler = string_post_handler, .user_ctx = NULL},
+    {.uri = "/string", .method = HTTP_DELETE, .handler = string_delete_handler, .user_ctx = NULL},
+    {.uri = API_CMD_PREFIX "*", .method = HTTP_GET, .handler = api_cmd_handler, .user_ctx = NULL},
+    {.uri = API_CMD_PREFIX "*", .method = HTTP_POST, .handler = api_cmd_handler, .user_ctx = NULL},
+#if CONFIG_METRICS_HISTORY_ENABLE
+    {.uri = "/api/history", .method = HTTP_GET, .handler = history_get_handler, .user_ctx = NULL},
+#endif
+};
+
+const httpd_uri_t *web_server_get_uri_handlers(size_t *count)
+{
+    *count = sizeof(s_uri_handlers) / sizeof(s_uri_handlers[0]);
+    return s_uri_handlers;
+}
+
+esp_err_t web_server_start_on_port(uint16_t port, uint16_t ctrl_port)
 {
     static httpd_handle_t server = NULL;
     if (server != NULL)
     {
         ESP_LOGI(TAG, "HTTP server already running");
-        return;
+        return ESP_OK;
     }
 
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    if (httpd_start(&server, &config) != ESP_OK)
-    {
-        ESP_LOGE(TAG, "Failed to start HTTP server");
-        return;
-    }
-
-    httpd_uri_t root_uri = {
-        .uri = "/",
-        .method = HTTP_GET,
-        .handler = root_get_handler,
-        .user_ctx = NULL};
-    httpd_register_uri_handler(server, &root_uri);
-
-    httpd_uri_t led_uri = {
-        .uri = "/led",
-        .method = HTTP_GET,
-        .handler = led_get_handler,
-        .user_ctx = NULL};
-    httpd_register_uri_handler(server, &led_uri);
-
-    httpd_uri_t string_get_uri = {
-        .uri = "/string",
-        .method = HTTP_GET,
-        .handler = string_get_handler,
-        .user_ctx = NULL};
-    httpd_register_uri_handler(server, &string_get_uri);
-
-    httpd_uri_t string_post_uri = {
-        .uri = "/string",
-        .method = HTTP_POST,
-        .handler = string_post_handler,
-        .user_ctx = NULL};
-    httpd_register_uri_handler(server, &string_post_uri);
-
-    httpd_uri_t string_delete_uri = {
-        .uri = "/string",
-        .method = HTTP_DELETE,
-        .handler = string_delete_handler,
-        .user_ctx = NULL};
-    httpd_register_uri_handler(server, &string_delete_uri);
-
-    ESP_LOGI(TAG, "HTTP server started");
+    config.server_port = port;
+    config.ctrl_port = ctrl_port;
+    config.uri_match_fn = httpd_uri_match_wildcard; /* for /api/cmd/<name> */
+    config.max_uri_handlers = sizeof(s_uri_handlers) / sizeof(s_uri_handlers[0]);
+    esp_err_t err = httpd_start(&server, &config);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start HTTP server on port %u", port);
+        server = NULL;
+        return err;
+    }
+
+    for (size_t i = 0; i < sizeof(s_uri_handlers) / sizeof(s_uri_handlers[0]); i++)
+    {
+        httpd_uri_t route = s_uri_handlers[i]; /* httpd keeps its own copy */
+#if CONFIG_METRICS_HISTORY_ENABLE
+        route.handler = timed_handler;
+        route.user_ctx = (void *)&s_uri_handlers[i];
+#endif
+        httpd_register_uri_handler(server, &route);
+    }
+
+    ESP_LOGI(TAG, "HTTP server started on port %u", port);
+    return ESP_OK;
+}
+
+void web_server_start(void)
+{
+    httpd_config_t defaults = HTTPD_DEFAULT_CONFIG();
+    (void)web_server_start_on_port(defaults.server_port, defaults.ctrl_port);
 }
@@ -1,7 +1,25 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_http_server.h"
+
 /* ======================= WEB SERVER HEADER ======================= */
 /*
- * Only exposes one helper so other modules can start the tiny HTTP server.
+ * Lets other modules start the tiny HTTP server.
  */
 void web_server_start(void);
+
+/*
+ * Same, on a chosen port. ctrl_port is httpd's internal control socket and
+ * must be unique too when several servers share one host (the simulator).
+ * Returns the httpd_start() error, e.g. when the port is taken.
+ */
+esp_err_t web_server_start_on_port(uint16_t port, uint16_t ctrl_port);
+
+/*
+ * The URI table web_server_start() registers. Handy for calling the
+ * handlers without a running server (benchmarks, simulators).
+ */
+const httpd_uri_t *web_server_get_uri_handlers(size_t *count);
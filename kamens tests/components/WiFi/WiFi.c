@@ -18,6 +18,9 @@
 
 #include "LED_Controler.h"
 #include "WEB_Server.h"
+#include "UDP_Control.h"
+#include "Executor.h"
+#include "Metrics_History.h"
 
 #include "esp_mac.h"
 
@@ -34,10 +37,34 @@ static const char *TAG = "wifi";
 static EventGroupHandle_t s_wifi_event_group;
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT BIT1
+#define SERVICES_STARTED_BIT BIT2
 
 /* Count how many retries we already did. */
 static int s_retry_num = 0;
 
+/* Starting servers takes a while; run it on the executor, not on the event loop task. */
+static int network_services_job(void *arg)
+{
+    (void)arg;
+#if CONFIG_WEB_SERVER_ENABLE
+    web_server_start(); /* Start serving HTTP once network is ready. */
+#endif
+#if CONFIG_UDP_CONTROL_ENABLE
+    udp_control_start(); /* Low-latency binary LED commands. */
+#endif
+    xEventGroupSetBits(s_wifi_event_group, SERVICES_STARTED_BIT);
+    return 0;
+}
+
+#if CONFIG_METRICS_HISTORY_ENABLE
+/* RSSI of the AP we are connected to, for the metrics history; 0 while not connected. */
+static int32_t wifi_rssi_source(void)
+{
+    wifi_ap_record_t ap;
+    return esp_wifi_sta_get_ap_info(&ap) == ESP_OK ? ap.rssi : 0;
+}
+#endif
+
 static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START)
@@ -66,7 +93,10 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t e
         ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
         s_retry_num = 0;
         led_control_set(1); /* Turn LED on to celebrate connection. */
-        web_server_start(); /* Start serving HTTP once network is ready. */
+        if (executor_submit(EXECUTOR_PRIO_HIGH, network_services_job, NULL, NULL, NULL) != ESP_OK)
+        {
+            network_services_job(NULL);
+        }
         xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
     }
 }
@@ -112,6 +142,9 @@ void wifi_manager_start(void)
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
     ESP_ERROR_CHECK(esp_wifi_start());
+#if CONFIG_METRICS_HISTORY_ENABLE
+    metrics_history_set_source(METRIC_RSSI, wifi_rssi_source);
+#endif
 
     ESP_LOGI(TAG, "wifi_manager_start: waiting for connection...");
 
@@ -125,6 +158,8 @@ void wifi_manager_start(void)
     if (bits & WIFI_CONNECTED_BIT)
     {
         ESP_LOGI(TAG, "Connected to AP. SSID:%s PASSWORD:%s", ESP_WIFI_SSID, ESP_WIFI_PASS);
+        /* The servers start on an executor worker; return only once they have, so callers see them running. */
+        xEventGroupWaitBits(s_wifi_event_group, SERVICES_STARTED_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
     }
     else if (bits & WIFI_FAIL_BIT)
     {
@@ -5,5 +5,6 @@
  * This header exposes one function that sets up WiFi as a station.
  * When the ESP32 gets an IP, the manager will turn the LED on
  * and ask the web server module to start.
+ * It returns once connected and the servers are running, or once it gave up.
  */
 void wifi_manager_start(void);
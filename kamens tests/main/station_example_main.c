@@ -3,9 +3,15 @@
  * @brief Main entry point - WiFi, Web Server, and BLE Central
  * 
  * Initializes all modules: NVS, LED, Storage, WiFi, Web Server, and BLE.
+ * WiFi, HTTP, UDP, serial and BLE can each be switched off in menuconfig;
+ * a disabled module is not compiled in at all.
  */
 
+#include <inttypes.h>
+
+#include "sdkconfig.h"
 #include "esp_log.h"
+#include "esp_system.h"
 #include "nvs_flash.h"
 #include "esp_mac.h"
 
@@ -14,6 +20,10 @@
 #include "WiFi.h"
 #include "WEB_Server.h"
 #include "BLE.h"
+#include "Serial_Control.h"
+#include "Command_Router.h"
+#include "Executor.h"
+#include "Metrics_History.h"
 
 static const char *TAG = "main";
 
@@ -31,6 +41,17 @@ void app_main(void)
     ESP_ERROR_CHECK(ret);
     ESP_LOGI(TAG, "NVS initialized");
 
+    /* Start the shared worker tasks before anything can submit jobs */
+    ESP_ERROR_CHECK(executor_start());
+    ESP_LOGI(TAG, "Executor started");
+
+#if CONFIG_METRICS_HISTORY_ENABLE
+    /* Sample from boot on, so the history covers the WiFi connect too */
+    if (metrics_history_start() == ESP_OK) {
+        ESP_LOGI(TAG, "Metrics history started");
+    }
+#endif
+
     /* Initialize LED control */
     led_control_init();
     ESP_LOGI(TAG, "LED control initialized");
@@ -39,10 +60,25 @@ void app_main(void)
     storage_manager_init();
     ESP_LOGI(TAG, "Storage manager initialized");
 
+#if CONFIG_COMMAND_ROUTER_BENCHMARK
+    /* Log how many cycles each command decoder takes */
+    command_router_benchmark();
+#endif
+
+#if CONFIG_SERIAL_CONTROL_ENABLE
+    /* Serial control needs no network, so bring it up before WiFi blocks */
+    if (serial_control_start() == ESP_OK) {
+        ESP_LOGI(TAG, "Serial control protocol started");
+    }
+#endif
+
+#if CONFIG_WIFI_MANAGER_ENABLE
     /* Start WiFi (will start web server when connected) */
     wifi_manager_start();
     ESP_LOGI(TAG, "WiFi manager started");
+#endif
 
+#if CONFIG_BLE_PERIPHERAL_ENABLE
     /* Initialize and start BLE Peripheral */
     int rc = ble_peripheral_init();
     if (rc != 0) {
@@ -50,7 +86,16 @@ void app_main(void)
     } else {
         ESP_LOGI(TAG, "BLE Peripheral started as 'ESP-SKYNET'. Waiting for connections...");
     }
+#endif
 
     ESP_LOGI(TAG, "=== All modules initialized ===");
+
+    /*
+     * Checked against size_budget.json by test_free_heap_at_boot.
+     * wifi_manager_start() only returns once the HTTP/UDP servers are up,
+     * so their allocations are always in this number.
+     */
+    ESP_LOGI(TAG, "Free heap at boot: %" PRIu32 " bytes (minimum so far %" PRIu32 ")",
+             esp_get_free_heap_size(), esp_get_minimum_free_heap_size());
 }
 
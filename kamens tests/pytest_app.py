@@ -1,14 +1,25 @@
 # SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
 # SPDX-License-Identifier: Unlicense OR CC0-1.0
+import http.client
+import json
 import os
 import re
+import socket
+import statistics
+import struct
+import subprocess
+import sys
 import time
-from typing import Callable, Tuple
+from typing import Callable, Dict, List, Optional, Tuple
 from urllib import error, request
 
 import pytest
 from pytest_embedded import Dut
 from pytest_embedded_idf.utils import idf_parametrize
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), 'tools'))
+import size_budget  # noqa: E402
+from serial_control import SerialControlClient  # noqa: E402
 # diff of esp32s2/esp32s3 ~45K, others ~50K
 
 DIFF_THRESHOLD = {
@@ -45,6 +56,47 @@ def test_wifi_sdkconfig_disable_softap_save_binary_size(
     assert diff > diff_threshold
 
 
+@pytest.mark.generic
+@pytest.mark.parametrize('config, skip_autoflash', [('default', 'y')], indirect=True)
+@idf_parametrize('target', ['esp32'], indirect=['target'])
+def test_component_size_budget(dut: Dut, log_performance: Callable[[str, object], None]) -> None:
+    # Only the build output is needed
+    dut.serial.close()
+    assert os.path.exists(size_budget.DEFAULT_BUDGET), \
+        'size_budget.json is missing, record one with: python tools/size_budget.py update --map <map>'
+
+    sizes = size_budget.load_sizes(map_path=os.path.splitext(dut.app.elf_file)[0] + '.map')
+    for name in size_budget.tracked_components():
+        if name in sizes:
+            log_performance(f'size_{name}', sizes[name])
+
+    budget = size_budget.load_budget()
+    if not size_budget.budget_recorded(budget):
+        pytest.skip('size_budget.json has no component budgets yet, record them with: '
+                    'python tools/size_budget.py update --map <map>')
+    problems = size_budget.check(sizes, budget)
+    assert not problems, 'components over budget:\n' + '\n'.join(problems)
+
+
+@pytest.mark.generic
+@pytest.mark.parametrize('config', ['default', 'no_ble', 'ble_only', 'serial_only'], indirect=True)
+@idf_parametrize('target', ['esp32', 'esp32c2'], indirect=['target'])
+def test_feature_variant_footprint(
+    dut: Dut,
+    config: str,
+    log_performance: Callable[[str, object], None],
+) -> None:
+    # Variants with WiFi give up after the retries when there is no AP, then log the heap.
+    match = dut.expect(re.compile(rb'Free heap at boot: (\d+) bytes'), timeout=120)
+    free_heap = int(match.group(1))
+    image_size = os.path.getsize(dut.app.bin_file)
+    log_performance(f'{config}_free_heap_at_boot', f'{free_heap} bytes')
+    log_performance(f'{config}_image_size', f'{image_size} bytes')
+
+    threshold = size_budget.min_free_heap_at_boot()
+    assert free_heap >= threshold, f'{config}: free heap at boot {free_heap} bytes, below {threshold}'
+
+
 def _wait_for_ip(dut: Dut, timeout: int = 90) -> str:
     match = dut.expect(re.compile(rb"Got IP: (\d+\.\d+\.\d+\.\d+)"), timeout=timeout)
     return match.group(1).decode()
@@ -80,6 +132,19 @@ def test_wifi_connection(connected_device: Tuple[Dut, str]) -> None:
     assert ip.count('.') == 3
 
 
+def test_free_heap_at_boot(
+    connected_device: Tuple[Dut, str],
+    log_performance: Callable[[str, object], None],
+) -> None:
+    dut, _ = connected_device
+    match = dut.expect(re.compile(rb'Free heap at boot: (\d+) bytes'), timeout=30)
+    free_heap = int(match.group(1))
+    log_performance('free_heap_at_boot', f'{free_heap} bytes')
+
+    threshold = size_budget.min_free_heap_at_boot()
+    assert free_heap >= threshold, f'free heap at boot {free_heap} bytes, below {threshold}'
+
+
 def test_led_control_endpoints(connected_device: Tuple[Dut, str]) -> None:
     _, ip = connected_device
     base_url = f'http://{ip}'
@@ -109,8 +174,232 @@ def test_storage_crud_endpoints(connected_device: Tuple[Dut, str]) -> None:
     _http_request(base_url + '/string', method='DELETE')
 
 
+def test_command_router_api(connected_device: Tuple[Dut, str]) -> None:
+    _, ip = connected_device
+    base_url = f'http://{ip}/api/cmd'
+
+    assert json.loads(_http_request(base_url + '/led_set?state=on')) == {'state': True}
+    assert json.loads(_http_request(base_url + '/led_get')) == {'state': True}
+
+    req = request.Request(base_url + '/string_set', data=b'{"value": "json \\u00e9"}', method='POST',
+                          headers={'Content-Type': 'application/json'})
+    request.urlopen(req, timeout=10).read()
+    assert json.loads(_http_request(base_url + '/string_get')) == {'value': 'json \u00e9'}
+
+    telemetry = json.loads(_http_request(base_url + '/telemetry'))
+    assert telemetry['free_heap'] > 0
+    assert telemetry['storage_flush_errors'] == 0  # the background NVS writes above all committed
+
+    with pytest.raises(error.HTTPError) as missing:
+        _http_request(base_url + '/led_set')
+    assert missing.value.code == 400
+    with pytest.raises(error.HTTPError) as unknown:
+        _http_request(base_url + '/no_such_command')
+    assert unknown.value.code == 404
+
+    _http_request(base_url + '/string_delete')
+    _http_request(base_url + '/led_set?state=off')
+
+
+def test_metrics_history_api(
+    connected_device: Tuple[Dut, str],
+    log_performance: Callable[[str, object], None],
+) -> None:
+    _, ip = connected_device
+    base_url = f'http://{ip}/api/history'
+
+    for _ in range(5):
+        _http_request(f'http://{ip}/led?state=on')
+    time.sleep(3)  # let the sampler record the seconds with those requests
+
+    history = json.loads(_http_request(base_url + '?last=30&tier=1s'))
+    assert history['tier'] == '1s' and history['interval_s'] == 1
+    assert history['metrics'][:3] == ['free_heap', 'rssi', 'requests']
+    rows = history['rows']
+    assert rows, 'no samples in the last 30 s'
+    assert all(len(row) == 1 + len(history['metrics']) for row in rows)
+    assert [row[0] for row in rows] == sorted({row[0] for row in rows})
+    assert history['now'] - 30 <= rows[0][0] and rows[-1][0] <= history['now']
+    assert all(row[1] > 0 for row in rows)  # free heap
+    assert sum(row[3] for row in rows) >= 5  # our requests (this one is still running)
+    assert any(row[2] < 0 for row in rows)  # RSSI while connected
+
+    assert history['dropped_samples'] == 0  # no query held the history for long, so every tick got its row
+    log_performance('metrics_history_bytes_per_row', round(history['stored_bytes'] / history['stored_rows'], 2))
+
+    with pytest.raises(error.HTTPError) as bad_tier:
+        _http_request(base_url + '?tier=5m')
+    assert bad_tier.value.code == 400
+
+
 def test_web_server_root_page(connected_device: Tuple[Dut, str]) -> None:
     _, ip = connected_device
     base_url = f'http://{ip}'
     html = _http_request(base_url + '/')
     assert 'ESP32 LED and String Control' in html
+
+
+UDP_CONTROL_PORT = 3333
+UDP_LATENCY_SAMPLES = 500
+# Histogram bucket upper edges in microseconds; the last bucket is open ended.
+LATENCY_BUCKETS_US = [250, 500, 1000, 2000, 5000, 10000, 20000, 50000]
+
+
+def _udp_led_command(sock: socket.socket, addr: Tuple[str, int], opcode: int, seq: int,
+                     attempts: int = 1) -> Optional[int]:
+    """Send one command and wait for its reply; None when every attempt timed out (datagram lost)."""
+    for _ in range(attempts):
+        sock.sendto(struct.pack('<2sBBI', b'LD', 1, opcode, seq), addr)
+        try:
+            while True:
+                reply = sock.recv(16)
+                magic, version, status, reply_seq = struct.unpack('<2sBBI', reply)
+                # Late replies to earlier, already timed-out commands are skipped.
+                if magic == b'LD' and version == 1 and reply_seq == seq:
+                    return status
+        except socket.timeout:
+            continue
+    return None
+
+
+def _latency_report(samples_us: List[float]) -> Dict[str, object]:
+    ordered = sorted(samples_us)
+    histogram = [0] * (len(LATENCY_BUCKETS_US) + 1)
+    for sample in ordered:
+        bucket = next((i for i, edge in enumerate(LATENCY_BUCKETS_US) if sample <= edge), len(LATENCY_BUCKETS_US))
+        histogram[bucket] += 1
+    return {
+        'p50_us': round(ordered[len(ordered) // 2]),
+        'p99_us': round(ordered[min(len(ordered) - 1, int(len(ordered) * 0.99))]),
+        'jitter_us': round(statistics.pstdev(ordered)),
+        'histogram': dict(zip([f'<={edge}' for edge in LATENCY_BUCKETS_US] + ['>'], histogram)),
+    }
+
+
+@pytest.mark.wifi_ap
+@pytest.mark.parametrize('config', ['udp_fast_path'], indirect=True)
+@idf_parametrize('target', ['esp32'], indirect=['target'])
+def test_udp_fast_path_latency(dut: Dut, log_performance: Callable[[str, object], None]) -> None:
+    ip = _wait_for_ip(dut)
+    dut.expect_exact('UDP LED fast path listening', timeout=10)
+    addr = (ip, UDP_CONTROL_PORT)
+
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        sock.settimeout(1)
+        assert _udp_led_command(sock, addr, 0x01, 1, attempts=3) == 0x81
+        assert _udp_led_command(sock, addr, 0x03, 2, attempts=3) == 0x81
+        assert _udp_led_command(sock, addr, 0x00, 3, attempts=3) == 0x80
+        assert _udp_led_command(sock, addr, 0x7F, 4, attempts=3) == 0xFF
+
+        # A lost datagram is counted and its sample skipped, it does not end the run.
+        udp_samples = []
+        udp_lost = 0
+        for seq in range(UDP_LATENCY_SAMPLES):
+            start = time.perf_counter()
+            if _udp_led_command(sock, addr, seq & 1, 100 + seq) is None:
+                udp_lost += 1
+                continue
+            udp_samples.append((time.perf_counter() - start) * 1e6)
+        assert udp_lost <= UDP_LATENCY_SAMPLES // 20, f'{udp_lost} of {UDP_LATENCY_SAMPLES} UDP commands lost'
+
+    # Same number of LED commands through the socket-based HTTP server for comparison,
+    # over one kept-alive connection so connection setup is not part of each sample.
+    http_samples = []
+    conn = http.client.HTTPConnection(ip, 80, timeout=10)
+    try:
+        conn.request('GET', '/led?state=off')
+        conn.getresponse().read()  # connect outside the timed loop
+        for seq in range(UDP_LATENCY_SAMPLES):
+            start = time.perf_counter()
+            conn.request('GET', f'/led?state={"on" if seq & 1 else "off"}')
+            resp = conn.getresponse()
+            resp.read()
+            http_samples.append((time.perf_counter() - start) * 1e6)
+            assert resp.status == 200
+    finally:
+        conn.close()
+
+    udp_report = _latency_report(udp_samples)
+    udp_report['lost'] = udp_lost
+    http_report = _latency_report(http_samples)
+    log_performance('udp_led_command_latency', udp_report)
+    log_performance('http_led_command_latency', http_report)
+
+    assert udp_report['p50_us'] < http_report['p50_us']
+
+
+@pytest.mark.generic
+@pytest.mark.parametrize('config', ['serial_control'], indirect=True)
+@idf_parametrize('target', ['esp32'], indirect=['target'])
+def test_serial_control_protocol(dut: Dut, log_performance: Callable[[str, object], None]) -> None:
+    # No network needed: talk to the board over the same serial port the log uses.
+    dut.expect_exact('Serial control protocol ready', timeout=30)
+    dut.serial.stop_redirect_thread()
+    client = SerialControlClient(dut.serial.proc)
+
+    assert client.ping(b'\x00abc\x00') == b'\x00abc\x00'
+    assert client.led_set(True) is True
+    assert client.led_get() is True
+    assert client.led_set(False) is False
+
+    client.string_set('hello-from-serial')
+    assert client.string_get() == 'hello-from-serial'
+    client.string_delete()
+    assert client.string_get() == ''
+
+    telemetry = client.telemetry()
+    assert telemetry['free_heap'] > 0
+    assert telemetry['storage_flush_errors'] == 0
+
+    log_performance('serial_control_led_pipelined', client.bench(count=1000, window=8))
+
+
+# QEMU's UART0 goes to this TCP port instead of stdio, so the host client can talk to it.
+QEMU_SERIAL_PORT = 5555
+
+
+def _serial_control_cli(*args: str) -> subprocess.CompletedProcess:
+    tool = os.path.join(os.path.dirname(__file__), 'tools', 'serial_control.py')
+    return subprocess.run([sys.executable, tool, '--port', f'socket://localhost:{QEMU_SERIAL_PORT}', *args],
+                          capture_output=True, text=True, timeout=120)
+
+
+@pytest.mark.host_test
+@pytest.mark.qemu
+@pytest.mark.parametrize('config', ['serial_control'], indirect=True)
+@pytest.mark.parametrize('qemu_extra_args', [f'-serial tcp::{QEMU_SERIAL_PORT},server=on,wait=off'], indirect=True)
+@idf_parametrize('target', ['esp32'], indirect=['target'])
+def test_serial_control_protocol_qemu(dut: Dut, log_performance: Callable[[str, object], None]) -> None:
+    # The log goes to the socket as well, so wait for boot by retrying until a command answers.
+    deadline = time.monotonic() + 60
+    while True:
+        result = _serial_control_cli('telemetry')
+        if result.returncode == 0 or time.monotonic() > deadline:
+            break
+        time.sleep(1)
+    assert result.returncode == 0, result.stderr
+    assert json.loads(result.stdout)['free_heap'] > 0
+
+    assert _serial_control_cli('led', 'on').stdout.strip() == 'on'
+    assert _serial_control_cli('led').stdout.strip() == 'on'
+    assert _serial_control_cli('string', 'hello-from-qemu').stdout.strip() == 'hello-from-qemu'
+    assert _serial_control_cli('string', '--delete').stdout.strip() == ''
+
+    result = _serial_control_cli('bench', '--count', '200', '--window', '8')
+    assert result.returncode == 0, result.stderr
+    log_performance('serial_control_led_pipelined_qemu', json.loads(result.stdout))
+
+
+@pytest.mark.generic
+@pytest.mark.parametrize('config', ['command_router_bench'], indirect=True)
+@idf_parametrize('target', ['esp32'], indirect=['target'])
+def test_command_router_decode_cost(dut: Dut, log_performance: Callable[[str, object], None]) -> None:
+    dut.expect_exact('Decode cost in CPU cycles', timeout=30)
+    pattern = re.compile(rb'(\w+)\s+form=(\d+) json=(\d+) cbor=(\d+)')
+    with open(os.path.join(os.path.dirname(__file__), 'components', 'Command_Router', 'commands.json')) as f:
+        command_count = len(json.load(f)['commands'])
+    for _ in range(command_count):
+        match = dut.expect(pattern, timeout=10)
+        name = match.group(1).decode()
+        for index, fmt in enumerate(('form', 'json', 'cbor'), start=2):
+            log_performance(f'command_decode_cycles_{name}_{fmt}', int(match.group(index)))
@@ -0,0 +1,58 @@
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+import json
+import os
+import sys
+from typing import Callable
+from urllib import request
+
+import pytest
+from pytest_embedded import Dut
+from pytest_embedded_idf.utils import idf_parametrize
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), '..', 'tools'))
+import fleet_sim  # noqa: E402
+
+# sim_main.c defaults, used by the instance pytest-embedded starts
+BASE_URL = 'http://127.0.0.1:8080'
+
+
+def _http_request(url: str, data: bytes | None = None, method: str = 'GET', timeout: int = 10) -> str:
+    req = request.Request(url, data=data, method=method)
+    with request.urlopen(req, timeout=timeout) as resp:
+        return resp.read().decode()
+
+
+@pytest.mark.host_test
+@idf_parametrize('target', ['linux'], indirect=['target'])
+def test_simulated_device_http(dut: Dut) -> None:
+    dut.expect_exact('SIM READY', timeout=30)
+
+    assert 'LED turned ON' in _http_request(BASE_URL + '/led?state=on')
+    assert json.loads(_http_request(BASE_URL + '/api/cmd/led_get')) == {'state': True}
+
+    _http_request(BASE_URL + '/string', data=b'value=simulated', method='POST')
+    assert 'simulated' in _http_request(BASE_URL + '/string')
+    _http_request(BASE_URL + '/string', method='DELETE')
+    assert '(empty)' in _http_request(BASE_URL + '/string')
+
+
+@pytest.mark.host_test
+@idf_parametrize('target', ['linux'], indirect=['target'])
+def test_simulated_fleet(dut: Dut, log_performance: Callable[[str, object], None]) -> None:
+    dut.expect_exact('SIM READY', timeout=30)
+
+    # Separate processes from the same binary, on ports clear of the one above
+    result = fleet_sim.run_fleet(dut.app.elf_file, devices=8, duration=5, rate=10,
+                                 log_dir=os.path.join(dut.logdir, 'fleet'))
+    with open(os.path.join(dut.logdir, 'fleet_report.json'), 'w', encoding='utf-8') as f:
+        json.dump(result, f, indent=2)
+
+    assert not result['exited'], f"devices exited early, logs in {result['log_dir']}"
+    assert result['total_errors'] == 0
+    assert all(row['requests'] > 0 for row in result['per_device'])
+    assert result['achieved_rate'] >= 0.9 * result['requested_rate'], \
+        f"fleet fell behind: {result['achieved_rate']} of {result['requested_rate']} requests/s per device"
+
+    log_performance('fleet_cpu_us_per_request', round(result['total_cpu_ms'] * 1000 / result['total_requests']))
+    log_performance('fleet_rss_kb_per_device', result['total_rss_kb'] // result['devices'])
+    log_performance('fleet_achieved_rate_per_device', result['achieved_rate'])
@@ -0,0 +1,100 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+"""Compare two runs of the component benchmarks (benchmarks/).
+
+Each input is either the JSON the benchmark app prints or a whole device
+log containing its ``BENCH_JSON:`` line. Results are matched by component
+and name; the change is reported for min, median and p99.
+
+Examples::
+
+    python tools/bench_diff.py before.log after.log
+    python tools/bench_diff.py before.json after.json --metric p99 --fail-above 10
+"""
+import argparse
+import json
+import sys
+from typing import Any, Dict, List, Optional, Tuple
+
+MARKER = 'BENCH_JSON: '
+METRICS = ('min', 'median', 'p99')
+
+Key = Tuple[str, str]
+
+
+def load_run(path: str) -> Dict[str, Any]:
+    with open(path, encoding='utf-8', errors='replace') as f:
+        text = f.read()
+    start = text.rfind(MARKER)
+    if start >= 0:
+        text = text[start + len(MARKER):].splitlines()[0]
+    return json.loads(text)
+
+
+def by_key(run: Dict[str, Any]) -> Dict[Key, Dict[str, Any]]:
+    return {(r['component'], r['name']): r for r in run['results']}
+
+
+def change_pct(old: int, new: int) -> Optional[float]:
+    if old == 0:
+        return None if new == 0 else float('inf')
+    return (new - old) * 100.0 / old
+
+
+def diff(old: Dict[str, Any], new: Dict[str, Any]) -> List[Dict[str, Any]]:
+    old_results, new_results = by_key(old), by_key(new)
+    rows = []
+    for key in list(old_results) + [k for k in new_results if k not in old_results]:
+        row: Dict[str, Any] = {'component': key[0], 'name': key[1]}
+        for metric in METRICS:
+            a = old_results.get(key, {}).get(metric)
+            b = new_results.get(key, {}).get(metric)
+            row[metric] = (a, b, change_pct(a, b) if a is not None and b is not None else None)
+        rows.append(row)
+    return rows
+
+
+def format_cell(a: Optional[int], b: Optional[int], pct: Optional[float]) -> str:
+    if a is None:
+        return f'new {b}'
+    if b is None:
+        return f'gone (was {a})'
+    change = '' if pct is None else f' ({pct:+.1f}%)'
+    return f'{a} -> {b}{change}'
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('old', help='baseline run (JSON or log)')
+    parser.add_argument('new', help='run to compare (JSON or log)')
+    parser.add_argument('--metric', choices=METRICS, default='median', help='metric checked by --fail-above')
+    parser.add_argument('--fail-above', type=float, metavar='PCT',
+                        help='exit with status 1 if any result got slower by more than PCT percent')
+    parser.add_argument('--json', action='store_true', help='print the comparison as JSON')
+    args = parser.parse_args()
+
+    old, new = load_run(args.old), load_run(args.new)
+    if old.get('unit') != new.get('unit') or old.get('target') != new.get('target'):
+        print(f"warning: comparing {old.get('target')}/{old.get('unit')} with {new.get('target')}/{new.get('unit')}",
+              file=sys.stderr)
+
+    rows = diff(old, new)
+    if args.json:
+        print(json.dumps(rows, indent=2))
+    else:
+        width = max(len(f"{r['component']} {r['name']}") for r in rows)
+        print(f"{'benchmark':<{width}}  " + '  '.join(f'{m:<26}' for m in METRICS) + f"  [{new.get('unit')}]")
+        for r in rows:
+            cells = '  '.join(f'{format_cell(*r[m]):<26}' for m in METRICS)
+            print(f"{r['component'] + ' ' + r['name']:<{width}}  {cells}")
+
+    if args.fail_above is not None:
+        slower = [r for r in rows if r[args.metric][2] is not None and r[args.metric][2] > args.fail_above]
+        for r in slower:
+            print(f"regression: {r['component']} {r['name']} {args.metric} {r[args.metric][2]:+.1f}%", file=sys.stderr)
+        return 1 if slower else 0
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
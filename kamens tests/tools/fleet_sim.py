@@ -0,0 +1,339 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+"""Run a fleet of simulated devices on one Linux host.
+
+Each device is one process of the simulator app (simulator/, built for the
+linux target): the firmware's HTTP handlers, Storage_Manager on emulated NVS
+and the LED state, serving real HTTP on its own localhost port. Per-device
+memory and CPU come from /proc.
+
+Examples::
+
+    cd simulator && idf.py --preview set-target linux build && cd ..
+    python tools/fleet_sim.py --devices 200 --duration 60 --rate 5      # built-in load, then a report
+    python tools/fleet_sim.py --devices 200 --hold                      # just keep the fleet up for your own backend
+    python tools/fleet_sim.py --devices 50 --duration 30 --json fleet.json
+
+Device i serves on --base-port + i. The report is sorted by CPU time, so the
+devices (and requests) that cost the most are at the top.
+
+The built-in load is open loop: each device has its own schedule and gets
+its next request on time even if the previous one has not been answered.
+Latency is measured from the scheduled send time. A device with
+MAX_IN_FLIGHT requests still open misses its next slot instead of tying up
+more client threads, so one slow device cannot slow the others down; the
+report shows the achieved rate next to the requested one.
+"""
+import argparse
+import concurrent.futures
+import heapq
+import json
+import os
+import signal
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import urllib.error
+import urllib.request
+from typing import Any, Dict, List, Optional, Tuple
+
+PROJECT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+DEFAULT_BINARY = os.path.join(PROJECT_DIR, 'simulator', 'build', 'device_simulator.elf')
+
+DEFAULT_BASE_PORT = 18000
+DEFAULT_CTRL_BASE_PORT = 40000  # httpd's UDP control socket, one per device as well
+
+READY_MARKER = b'SIM READY'
+
+# Open requests per device before its next scheduled request is counted as missed.
+MAX_IN_FLIGHT = 4
+
+CLOCK_TICKS = os.sysconf('SC_CLK_TCK')
+
+# (method, path, body) cycled through by the built-in load; the same calls the app and backend make.
+REQUEST_MIX: List[Tuple[str, str, Optional[bytes]]] = [
+    ('GET', '/led?state=on', None),
+    ('GET', '/string', None),
+    ('POST', '/string', b'value=fleet'),
+    ('GET', '/led?state=off', None),
+    ('GET', '/api/cmd/telemetry', None),
+]
+
+
+class Device:
+    def __init__(self, index: int, binary: str, port: int, ctrl_port: int, log_dir: str) -> None:
+        self.index = index
+        self.port = port
+        self.log_path = os.path.join(log_dir, f'device_{index:04d}.log')
+        env = dict(os.environ, SIM_HTTP_PORT=str(port), SIM_CTRL_PORT=str(ctrl_port), SIM_DEVICE_ID=f'dev{index}')
+        with open(self.log_path, 'wb') as log:
+            self.proc = subprocess.Popen([binary], stdin=subprocess.DEVNULL, stdout=log, stderr=subprocess.STDOUT,
+                                         env=env)
+        self.lock = threading.Lock()
+        self.latencies_ms: List[float] = []
+        self.errors = 0
+        self.in_flight = 0
+        self.missed = 0
+
+    @property
+    def url(self) -> str:
+        return f'http://127.0.0.1:{self.port}'
+
+    def ready(self) -> bool:
+        with open(self.log_path, 'rb') as log:
+            return READY_MARKER in log.read()
+
+    def try_send(self) -> bool:
+        """Claim an in-flight slot for the next request; False (and one more miss) if the device is saturated."""
+        with self.lock:
+            if self.in_flight >= MAX_IN_FLIGHT:
+                self.missed += 1
+                return False
+            self.in_flight += 1
+            return True
+
+    def record(self, latency_ms: Optional[float]) -> None:
+        with self.lock:
+            self.in_flight -= 1
+            if latency_ms is None:
+                self.errors += 1
+            else:
+                self.latencies_ms.append(latency_ms)
+
+    def stop(self) -> None:
+        if self.proc.poll() is None:
+            self.proc.send_signal(signal.SIGINT)
+            try:
+                self.proc.wait(timeout=2)
+            except subprocess.TimeoutExpired:
+                self.proc.kill()
+                self.proc.wait()
+
+
+def proc_stats(pid: int) -> Dict[str, float]:
+    """CPU seconds (user + system), resident and peak resident memory in KB of one process."""
+    with open(f'/proc/{pid}/stat', encoding='ascii') as f:
+        fields = f.read().rsplit(')', 1)[1].split()  # the command name may contain spaces
+    cpu_s = (int(fields[11]) + int(fields[12])) / CLOCK_TICKS  # utime, stime
+    memory = {}
+    with open(f'/proc/{pid}/status', encoding='ascii') as f:
+        for line in f:
+            key, _, value = line.partition(':')
+            if key in ('VmRSS', 'VmHWM'):
+                memory[key] = int(value.split()[0])
+    return {'cpu_s': cpu_s, 'rss_kb': memory.get('VmRSS', 0), 'peak_rss_kb': memory.get('VmHWM', 0)}
+
+
+def start_fleet(binary: str, count: int, base_port: int, ctrl_base_port: int, log_dir: str,
+                timeout: float = 30.0) -> List[Device]:
+    devices = [Device(i, binary, base_port + i, ctrl_base_port + i, log_dir) for i in range(count)]
+    deadline = time.monotonic() + timeout
+    waiting = list(devices)
+    while waiting:
+        for device in list(waiting):
+            if device.ready():
+                waiting.remove(device)
+            elif device.proc.poll() is not None:
+                stop_fleet(devices)
+                raise RuntimeError(f'device {device.index} exited with {device.proc.returncode}, see {device.log_path}')
+        if waiting and time.monotonic() > deadline:
+            stop_fleet(devices)
+            raise RuntimeError(f'{len(waiting)} devices not ready after {timeout:.0f} s, e.g. {waiting[0].log_path}')
+        time.sleep(0.05)
+    return devices
+
+
+def stop_fleet(devices: List[Device]) -> None:
+    for device in devices:
+        device.stop()
+
+
+def http_call(device: Device, method: str, path: str, body: Optional[bytes], scheduled: float,
+              timeout: float = 5.0) -> None:
+    """One request; the latency counts from ``scheduled`` (time.monotonic()), not from when a worker got to it."""
+    request = urllib.request.Request(device.url + path, data=body, method=method)
+    if body is not None:
+        request.add_header('Content-Type', 'application/x-www-form-urlencoded')
+    try:
+        with urllib.request.urlopen(request, timeout=timeout) as response:
+            response.read()
+    except (urllib.error.URLError, OSError):
+        device.record(None)
+        return
+    device.record((time.monotonic() - scheduled) * 1000)
+
+
+def run_load(devices: List[Device], duration: float, rate: float, workers: int) -> None:
+    """Open loop: ``rate`` requests per second to each device for ``duration`` seconds, cycling through REQUEST_MIX.
+
+    Every device has its own schedule, spread over one interval so the fleet is not hit all at once.
+    A request goes out when it is due, whether or not the device answered the previous ones,
+    unless MAX_IN_FLIGHT are still open; then that slot is missed.
+    """
+    interval = 1.0 / rate
+    start = time.monotonic()
+    due = [(start + i * interval / len(devices), i) for i in range(len(devices))]
+    slot = [0] * len(devices)
+    with concurrent.futures.ThreadPoolExecutor(max_workers=workers) as pool:
+        while due:
+            when, i = heapq.heappop(due)
+            if when - start >= duration:
+                break  # the heap is ordered, so every other device is done as well
+            sleep = when - time.monotonic()
+            if sleep > 0:
+                time.sleep(sleep)
+            method, path, body = REQUEST_MIX[slot[i] % len(REQUEST_MIX)]
+            if devices[i].try_send():
+                pool.submit(http_call, devices[i], method, path, body, when)
+            slot[i] += 1
+            heapq.heappush(due, (when + interval, i))
+
+
+def percentile(values: List[float], pct: float) -> float:
+    if not values:
+        return 0.0
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(len(ordered) * pct / 100))]
+
+
+def report(devices: List[Device], before: Dict[int, Dict[str, float]], wall_s: float,
+           rate: Optional[float] = None, load_s: Optional[float] = None) -> Dict[str, Any]:
+    """Per-device CPU, memory and latency.
+
+    With the built-in load, ``rate`` is what was asked for during ``load_s`` seconds. The achieved rate
+    counts the requests that were sent in that time (answered or failed), so missed slots lower it.
+    """
+    load_s = load_s or wall_s
+    rows = []
+    for device in devices:
+        if device.proc.poll() is not None:
+            rows.append({'device': device.index, 'port': device.port, 'exited': device.proc.returncode})
+            continue
+        now = proc_stats(device.proc.pid)
+        cpu_s = now['cpu_s'] - before[device.index]['cpu_s']
+        requests = len(device.latencies_ms)
+        rows.append({
+            'device': device.index,
+            'port': device.port,
+            'requests': requests,
+            'req_per_s': round((requests + device.errors) / load_s, 2) if load_s else 0.0,
+            'missed': device.missed,
+            'errors': device.errors,
+            'p50_ms': round(percentile(device.latencies_ms, 50), 2),
+            'p99_ms': round(percentile(device.latencies_ms, 99), 2),
+            'cpu_ms': round(cpu_s * 1000, 1),
+            'cpu_pct': round(100 * cpu_s / wall_s, 2) if wall_s else 0.0,
+            'cpu_us_per_request': round(cpu_s * 1e6 / requests) if requests else None,
+            'rss_kb': now['rss_kb'],
+            'peak_rss_kb': now['peak_rss_kb'],
+        })
+    rows.sort(key=lambda row: row.get('cpu_ms', 0), reverse=True)
+    live = [row for row in rows if 'exited' not in row]
+    total_requests = sum(row['requests'] for row in live)
+    return {
+        'devices': len(devices),
+        'wall_s': round(wall_s, 2),
+        'requested_rate': rate,  # per device, None when the load came from outside (--hold)
+        'achieved_rate': round(sum(row['req_per_s'] for row in live) / len(live), 2) if live else 0.0,
+        'total_requests': total_requests,
+        'total_missed': sum(row['missed'] for row in live),
+        'total_errors': sum(row['errors'] for row in live),
+        'total_cpu_ms': round(sum(row['cpu_ms'] for row in live), 1),
+        'total_rss_kb': sum(row['rss_kb'] for row in live),
+        'exited': [row['device'] for row in rows if 'exited' in row],
+        'per_device': rows,
+    }
+
+
+def print_report(result: Dict[str, Any], top: int) -> None:
+    print(f"{result['devices']} devices, {result['wall_s']} s: {result['total_requests']} requests, "
+          f"{result['total_errors']} errors, {result['total_cpu_ms']} ms CPU, {result['total_rss_kb']} KB RSS")
+    if result['requested_rate'] is not None:
+        print(f"rate per device: {result['requested_rate']} requests/s requested, {result['achieved_rate']} achieved "
+              f"({result['total_missed']} slots missed)")
+    if result['exited']:
+        print(f"exited early: {result['exited']}")
+    header = ('device', 'port', 'requests', 'req_per_s', 'missed', 'errors', 'p50_ms', 'p99_ms', 'cpu_ms', 'cpu_pct', 'cpu_us_per_request',
+              'rss_kb', 'peak_rss_kb')
+    print(''.join(f'{h:>12}' if h != 'cpu_us_per_request' else f'{"cpu_us/req":>12}' for h in header))
+    for row in [r for r in result['per_device'] if 'exited' not in r][:top]:
+        print(''.join(f'{str(row[h]):>12}' for h in header))
+
+
+def run_fleet(binary: str, devices: int, duration: float, rate: float, base_port: int = DEFAULT_BASE_PORT,
+              ctrl_base_port: int = DEFAULT_CTRL_BASE_PORT, log_dir: Optional[str] = None,
+              workers: int = 64) -> Dict[str, Any]:
+    """Start a fleet, load it for ``duration`` seconds, stop it and return the report."""
+    log_dir = log_dir or tempfile.mkdtemp(prefix='fleet_sim_')
+    fleet = start_fleet(binary, devices, base_port, ctrl_base_port, log_dir)
+    try:
+        before = {device.index: proc_stats(device.proc.pid) for device in fleet}
+        start = time.monotonic()
+        run_load(fleet, duration, rate, min(workers, devices * MAX_IN_FLIGHT))
+        result = report(fleet, before, time.monotonic() - start, rate, duration)
+    finally:
+        stop_fleet(fleet)
+    result['log_dir'] = log_dir
+    return result
+
+
+def hold(binary: str, devices: int, base_port: int, ctrl_base_port: int, log_dir: str, every: float,
+         top: int) -> None:
+    """Keep the fleet up for an external load generator, printing a report every ``every`` seconds."""
+    fleet = start_fleet(binary, devices, base_port, ctrl_base_port, log_dir)
+    print(f'{devices} devices on 127.0.0.1:{base_port}..{base_port + devices - 1}, logs in {log_dir}. Ctrl-C stops.')
+    try:
+        while True:
+            before = {device.index: proc_stats(device.proc.pid) for device in fleet if device.proc.poll() is None}
+            start = time.monotonic()
+            time.sleep(every)
+            print_report(report([d for d in fleet if d.index in before], before, time.monotonic() - start), top)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        stop_fleet(fleet)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--binary', default=DEFAULT_BINARY, help='simulator built for the linux target')
+    parser.add_argument('--devices', type=int, default=10)
+    parser.add_argument('--base-port', type=int, default=DEFAULT_BASE_PORT)
+    parser.add_argument('--ctrl-base-port', type=int, default=DEFAULT_CTRL_BASE_PORT)
+    parser.add_argument('--log-dir', help='one log file per device (default: a new temporary directory)')
+    parser.add_argument('--duration', type=float, default=10.0, help='seconds of built-in load')
+    parser.add_argument('--rate', type=float, default=5.0, help='requests per second per device')
+    parser.add_argument('--workers', type=int, default=64, help='client threads for the built-in load')
+    parser.add_argument('--hold', action='store_true', help='no built-in load, keep running until Ctrl-C')
+    parser.add_argument('--every', type=float, default=10.0, help='report interval with --hold')
+    parser.add_argument('--top', type=int, default=20, help='devices shown in the table')
+    parser.add_argument('--json', help='also write the full report here')
+    args = parser.parse_args()
+
+    if not os.path.exists(args.binary):
+        print(f'error: {args.binary} not found, build simulator/ for the linux target first', file=sys.stderr)
+        return 1
+    for first, name in ((args.base_port, '--base-port'), (args.ctrl_base_port, '--ctrl-base-port')):
+        if first + args.devices > 65536:
+            print(f'error: {name} {first} + {args.devices} devices runs past port 65535', file=sys.stderr)
+            return 1
+
+    log_dir = args.log_dir or tempfile.mkdtemp(prefix='fleet_sim_')
+    os.makedirs(log_dir, exist_ok=True)
+    if args.hold:
+        hold(args.binary, args.devices, args.base_port, args.ctrl_base_port, log_dir, args.every, args.top)
+        return 0
+
+    result = run_fleet(args.binary, args.devices, args.duration, args.rate, args.base_port, args.ctrl_base_port,
+                       log_dir, args.workers)
+    print_report(result, args.top)
+    if args.json:
+        with open(args.json, 'w', encoding='utf-8') as f:
+            json.dump(result, f, indent=2)
+    return 1 if result['total_errors'] or result['exited'] else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
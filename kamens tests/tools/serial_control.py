@@ -0,0 +1,331 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+"""Host client for the binary serial control protocol (components/Serial_Control).
+
+Works against a real board (``/dev/ttyUSB0``) or QEMU's serial port
+(``socket://localhost:5555``). Anything on the line that is not a valid
+frame - usually log output - is handed to an optional callback and skipped.
+
+Examples::
+
+    python tools/serial_control.py --port /dev/ttyUSB0 led on
+    python tools/serial_control.py --port socket://localhost:5555 telemetry
+    python tools/serial_control.py --port socket://localhost:5555 bench --count 2000 --window 8
+"""
+import argparse
+import json
+import os
+import statistics
+import struct
+import sys
+import time
+from typing import Any, Callable, Dict, List, Optional, Tuple
+
+CMD_PING = 0x01
+CMD_LED_SET = 0x10
+CMD_LED_GET = 0x11
+CMD_STRING_GET = 0x20
+CMD_STRING_SET = 0x21
+CMD_STRING_DELETE = 0x22
+CMD_TELEMETRY = 0x30
+CMD_ROUTER = 0x40
+
+RESPONSE_FLAG = 0x80
+
+STATUS_OK = 0x00
+STATUS_NAMES = {
+    0x00: 'ok',
+    0x01: 'bad request',
+    0x02: 'unknown command',
+    0x03: 'too long',
+    0x04: 'failed',
+}
+
+# Command names and ids shared with the firmware's command router.
+COMMANDS_JSON = os.path.join(os.path.dirname(__file__), '..', 'components', 'Command_Router', 'commands.json')
+
+
+class SerialControlError(Exception):
+    pass
+
+
+def crc16_ccitt(data: bytes) -> int:
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data: bytes) -> bytes:
+    out = bytearray([0])
+    code_idx = 0
+    code = 1
+    for byte in data:
+        if byte == 0:
+            out[code_idx] = code
+            code = 1
+            code_idx = len(out)
+            out.append(0)
+        else:
+            out.append(byte)
+            code += 1
+            if code == 0xFF:
+                out[code_idx] = code
+                code = 1
+                code_idx = len(out)
+                out.append(0)
+    out[code_idx] = code
+    return bytes(out)
+
+
+def cobs_decode(data: bytes) -> Optional[bytes]:
+    out = bytearray()
+    idx = 0
+    while idx < len(data):
+        code = data[idx]
+        if code == 0 or idx + code > len(data):
+            return None
+        out += data[idx + 1:idx + code]
+        idx += code
+        if code != 0xFF and idx != len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def _cbor_head(major: int, value: int) -> bytes:
+    if value < 24:
+        return bytes([major << 5 | value])
+    for ai, size in ((24, 1), (25, 2), (26, 4)):
+        if value < 1 << (8 * size):
+            return bytes([major << 5 | ai]) + value.to_bytes(size, 'big')
+    raise ValueError('value too large')
+
+
+def cbor_encode(value: Any) -> bytes:
+    """Just enough CBOR for command arguments: maps, text, unsigned ints and bools."""
+    if isinstance(value, bool):
+        return bytes([0xF5 if value else 0xF4])
+    if isinstance(value, int):
+        return _cbor_head(0, value)
+    if isinstance(value, str):
+        return _cbor_head(3, len(value.encode())) + value.encode()
+    if isinstance(value, dict):
+        return _cbor_head(5, len(value)) + b''.join(cbor_encode(k) + cbor_encode(v) for k, v in value.items())
+    raise TypeError(f'cannot CBOR encode {type(value).__name__}')
+
+
+def cbor_decode(data: bytes) -> Any:
+    def item(pos: int) -> Tuple[Any, int]:
+        major, ai = data[pos] >> 5, data[pos] & 0x1F
+        pos += 1
+        if major == 7:
+            return {20: False, 21: True, 22: None}[ai], pos
+        if ai < 24:
+            value = ai
+        else:
+            size = {24: 1, 25: 2, 26: 4}[ai]
+            value = int.from_bytes(data[pos:pos + size], 'big')
+            pos += size
+        if major == 0:
+            return value, pos
+        if major == 3:
+            return data[pos:pos + value].decode(), pos + value
+        if major == 5:
+            result = {}
+            for _ in range(value):
+                key, pos = item(pos)
+                result[key], pos = item(pos)
+            return result, pos
+        raise ValueError(f'unsupported CBOR major type {major}')
+
+    return item(0)[0]
+
+
+def encode_request(cmd: int, request_id: int, payload: bytes = b'') -> bytes:
+    body = struct.pack('<BH', cmd, request_id) + payload
+    body += struct.pack('<H', crc16_ccitt(body))
+    return b'\x00' + cobs_encode(body) + b'\x00'
+
+
+def decode_response(frame: bytes) -> Optional[Tuple[int, int, int, bytes]]:
+    """Return (cmd, request_id, status, payload) or None if frame is not a valid response."""
+    body = cobs_decode(frame)
+    if body is None or len(body) < 6:
+        return None
+    if struct.unpack('<H', body[-2:])[0] != crc16_ccitt(body[:-2]):
+        return None
+    cmd, request_id, status = struct.unpack('<BHB', body[:4])
+    if not cmd & RESPONSE_FLAG:
+        return None
+    return cmd & ~RESPONSE_FLAG, request_id, status, body[4:-2]
+
+
+class SerialControlClient:
+    """Pipelined client. ``port`` is anything with pyserial's read/write/in_waiting."""
+
+    def __init__(self, port: Any, on_noise: Optional[Callable[[bytes], None]] = None) -> None:
+        self.port = port
+        self.on_noise = on_noise
+        self._next_id = 0
+        self._rx = bytearray()
+        self._pending: Dict[int, Tuple[int, int, bytes]] = {}
+
+    @classmethod
+    def open(cls, url: str, baudrate: int = 115200, **kwargs: Any) -> 'SerialControlClient':
+        import serial  # pyserial; imported here so the codec works without it
+
+        return cls(serial.serial_for_url(url, baudrate=baudrate, timeout=0.05), **kwargs)
+
+    def close(self) -> None:
+        self.port.close()
+
+    # ---- pipelining primitives ----
+
+    def send(self, cmd: int, payload: bytes = b'') -> int:
+        request_id = self._next_id
+        self._next_id = (self._next_id + 1) & 0xFFFF
+        self.port.write(encode_request(cmd, request_id, payload))
+        return request_id
+
+    def wait(self, request_id: int, timeout: float = 2.0) -> bytes:
+        deadline = time.monotonic() + timeout
+        while request_id not in self._pending:
+            if time.monotonic() > deadline:
+                raise SerialControlError(f'timeout waiting for request {request_id}')
+            self._poll()
+        _, status, payload = self._pending.pop(request_id)
+        if status != STATUS_OK:
+            raise SerialControlError(STATUS_NAMES.get(status, f'status {status}'))
+        return payload
+
+    def call(self, cmd: int, payload: bytes = b'', timeout: float = 2.0) -> bytes:
+        return self.wait(self.send(cmd, payload), timeout)
+
+    def _poll(self) -> None:
+        self._rx += self.port.read(max(1, getattr(self.port, 'in_waiting', 0)))
+        while True:
+            end = self._rx.find(b'\x00')
+            if end < 0:
+                return
+            chunk = bytes(self._rx[:end])
+            del self._rx[:end + 1]
+            if not chunk:
+                continue
+            response = decode_response(chunk)
+            if response is None:
+                if self.on_noise:
+                    self.on_noise(chunk)
+                continue
+            cmd, request_id, status, payload = response
+            self._pending[request_id] = (cmd, status, payload)
+
+    # ---- commands, same set as the HTTP API ----
+
+    def ping(self, data: bytes = b'') -> bytes:
+        return self.call(CMD_PING, data)
+
+    def led_set(self, on: bool) -> bool:
+        return bool(self.call(CMD_LED_SET, bytes([1 if on else 0]))[0])
+
+    def led_get(self) -> bool:
+        return bool(self.call(CMD_LED_GET)[0])
+
+    def string_get(self) -> str:
+        return self.call(CMD_STRING_GET).decode()
+
+    def string_set(self, value: str) -> None:
+        self.call(CMD_STRING_SET, value.encode())
+
+    def string_delete(self) -> None:
+        self.call(CMD_STRING_DELETE)
+
+    def telemetry(self) -> Dict[str, int]:
+        uptime_ms, free_heap, min_free_heap, led, flush_errors = struct.unpack('<IIIBI', self.call(CMD_TELEMETRY))
+        return {'uptime_ms': uptime_ms, 'free_heap': free_heap, 'min_free_heap': min_free_heap, 'led': led,
+                'storage_flush_errors': flush_errors}
+
+    def command(self, name: str, **args: Any) -> Dict[str, Any]:
+        """Run any command from commands.json by name, e.g. ``command('led_set', state=True)``."""
+        if not hasattr(self, '_command_ids'):
+            with open(COMMANDS_JSON, encoding='utf-8') as f:
+                self._command_ids = {cmd['name']: cmd['id'] for cmd in json.load(f)['commands']}
+        payload = bytes([self._command_ids[name]]) + cbor_encode(args)
+        return cbor_decode(self.call(CMD_ROUTER, payload))
+
+    # ---- benchmark ----
+
+    def bench(self, count: int = 1000, window: int = 8) -> Dict[str, Any]:
+        """Toggle the LED ``count`` times with up to ``window`` requests in flight."""
+        sent_at: Dict[int, float] = {}
+        latencies_us: List[float] = []
+        in_flight: List[int] = []
+        start = time.perf_counter()
+        for i in range(count):
+            if len(in_flight) >= window:
+                request_id = in_flight.pop(0)
+                self.wait(request_id)
+                latencies_us.append((time.perf_counter() - sent_at.pop(request_id)) * 1e6)
+            request_id = self.send(CMD_LED_SET, bytes([i & 1]))
+            sent_at[request_id] = time.perf_counter()
+            in_flight.append(request_id)
+        for request_id in in_flight:
+            self.wait(request_id)
+            latencies_us.append((time.perf_counter() - sent_at.pop(request_id)) * 1e6)
+        elapsed = time.perf_counter() - start
+        latencies_us.sort()
+        return {
+            'count': count,
+            'window': window,
+            'commands_per_s': round(count / elapsed),
+            'p50_us': round(latencies_us[len(latencies_us) // 2]),
+            'p99_us': round(latencies_us[min(len(latencies_us) - 1, int(len(latencies_us) * 0.99))]),
+            'jitter_us': round(statistics.pstdev(latencies_us)),
+        }
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--port', required=True, help='serial port or pyserial URL, e.g. socket://localhost:5555')
+    parser.add_argument('--baud', type=int, default=115200)
+    parser.add_argument('--show-log', action='store_true', help='print non-frame output (device log)')
+    sub = parser.add_subparsers(dest='command', required=True)
+    led = sub.add_parser('led')
+    led.add_argument('state', nargs='?', choices=['on', 'off'])
+    string = sub.add_parser('string')
+    string.add_argument('value', nargs='?')
+    string.add_argument('--delete', action='store_true')
+    sub.add_parser('telemetry')
+    bench = sub.add_parser('bench')
+    bench.add_argument('--count', type=int, default=1000)
+    bench.add_argument('--window', type=int, default=8)
+    args = parser.parse_args()
+
+    on_noise = (lambda chunk: sys.stderr.write(chunk.decode(errors='replace'))) if args.show_log else None
+    client = SerialControlClient.open(args.port, args.baud, on_noise=on_noise)
+    try:
+        if args.command == 'led':
+            state = client.led_get() if args.state is None else client.led_set(args.state == 'on')
+            print('on' if state else 'off')
+        elif args.command == 'string':
+            if args.delete:
+                client.string_delete()
+            elif args.value is not None:
+                client.string_set(args.value)
+            print(client.string_get())
+        elif args.command == 'telemetry':
+            print(json.dumps(client.telemetry()))
+        elif args.command == 'bench':
+            print(json.dumps(client.bench(args.count, args.window)))
+    except SerialControlError as e:
+        print(f'error: {e}', file=sys.stderr)
+        return 1
+    finally:
+        client.close()
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: Unlicense OR CC0-1.0
+"""Per-component IRAM / DRAM / flash budget for the app.
+
+Reads the output of ``idf.py size-components --format json2`` (or runs
+esp_idf_size on the map file itself) and either records it as the budget
+or checks it against the budget in size_budget.json.
+
+Examples::
+
+    idf.py build
+    python tools/size_budget.py update --map build/wifi_station.map   # record current sizes + headroom
+    python tools/size_budget.py check --map build/wifi_station.map    # exit 1 if a component grew past its budget
+
+    idf.py size-components --format json2 > size.json
+    python tools/size_budget.py check --size-json size.json
+
+``cmake --build build --target size-budget`` runs the check after a build.
+"""
+import argparse
+import json
+import math
+import os
+import subprocess
+import sys
+from typing import Any, Dict, List, Optional
+
+PROJECT_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..')
+DEFAULT_BUDGET = os.path.join(PROJECT_DIR, 'size_budget.json')
+
+REGIONS = ('iram', 'dram', 'flash')
+
+# IDF libraries tracked next to the project's own components: most of the
+# footprint of WiFi / BLE / WEB_Server is in these, not in our wrappers.
+EXTRA_TRACKED = ('bt', 'esp_wifi', 'net80211', 'pp', 'wpa_supplicant', 'lwip', 'esp_http_server', 'nvs_flash')
+
+# Used when size_budget.json does not set min_free_heap_at_boot.
+DEFAULT_MIN_FREE_HEAP = 40 * 1024
+
+DEFAULT_HEADROOM_PCT = 5
+MIN_HEADROOM_BYTES = 256
+
+Sizes = Dict[str, Dict[str, int]]
+
+
+def region_of(name: str) -> Optional[str]:
+    """Map a section name (.iram0.text) or legacy size key (iram_text) to a budget region."""
+    n = name.lower().lstrip('.')
+    if n.startswith('flash'):
+        return 'flash'
+    if n.startswith('iram') or (n.startswith('diram') and 'text' in n):
+        return 'iram'
+    if n.startswith('dram') or n.startswith('diram'):
+        return 'dram'
+    return None  # RTC memory, totals, ...
+
+
+def component_of(archive: str) -> str:
+    name = os.path.basename(archive)
+    if name.startswith('lib'):
+        name = name[3:]
+    if name.endswith('.a'):
+        name = name[:-2]
+    return name
+
+
+def parse_size_components(text: str) -> Sizes:
+    """Parse size-components JSON (json2 or the older json format) into {component: {region: bytes}}."""
+    data = json.loads(text[text.index('{'):])  # idf.py may print a few lines before the JSON
+    archives = data.get('archives', data)
+    sizes: Sizes = {}
+    for archive, info in archives.items():
+        if not isinstance(info, dict) or not archive.endswith('.a'):
+            continue
+        regions = dict.fromkeys(REGIONS, 0)
+        if 'memory_types' in info:
+            for mem_type in info['memory_types'].values():
+                for section, section_info in mem_type.get('sections', {}).items():
+                    region = region_of(section)
+                    if region:
+                        regions[region] += int(section_info['size'])
+        else:
+            for key, value in info.items():
+                region = region_of(key)
+                if region and isinstance(value, int):
+                    regions[region] += value
+        sizes[component_of(archive)] = regions
+    return sizes
+
+
+def run_idf_size(map_path: str) -> str:
+    cmd = [sys.executable, '-m', 'esp_idf_size', '--format', 'json2', '--archives', map_path]
+    return subprocess.run(cmd, check=True, capture_output=True, text=True).stdout
+
+
+def load_sizes(map_path: Optional[str] = None, size_json: Optional[str] = None) -> Sizes:
+    if size_json:
+        with open(size_json, encoding='utf-8') as f:
+            return parse_size_components(f.read())
+    if map_path:
+        return parse_size_components(run_idf_size(map_path))
+    raise ValueError('need a map file or size-components JSON')
+
+
+def tracked_components() -> List[str]:
+    components_dir = os.path.join(PROJECT_DIR, 'components')
+    own = sorted(d for d in os.listdir(components_dir) if os.path.isdir(os.path.join(components_dir, d)))
+    return ['main'] + own + list(EXTRA_TRACKED)
+
+
+def load_budget(path: str = DEFAULT_BUDGET) -> Dict[str, Any]:
+    with open(path, encoding='utf-8') as f:
+        return json.load(f)
+
+
+def budget_recorded(budget: Optional[Dict[str, Any]]) -> bool:
+    """False until ``update`` has written component budgets from a reference build."""
+    return bool((budget or {}).get('components'))
+
+
+def min_free_heap_at_boot(path: str = DEFAULT_BUDGET) -> int:
+    """The free heap the app must have left after start-up, from size_budget.json if it sets one."""
+    if not os.path.exists(path):
+        return DEFAULT_MIN_FREE_HEAP
+    return int(load_budget(path).get('min_free_heap_at_boot', DEFAULT_MIN_FREE_HEAP))
+
+
+def make_budget(sizes: Sizes, old: Optional[Dict[str, Any]], headroom_pct: float) -> Dict[str, Any]:
+    def limit(used: int) -> int:
+        if used == 0:
+            return 0  # a component that starts using this region should be noticed
+        return used + max(MIN_HEADROOM_BYTES, math.ceil(used * headroom_pct / 100))
+
+    components = {
+        name: {region: limit(sizes[name][region]) for region in REGIONS}
+        for name in tracked_components()
+        if name in sizes
+    }
+    return {
+        'headroom_pct': headroom_pct,
+        'min_free_heap_at_boot': (old or {}).get('min_free_heap_at_boot', DEFAULT_MIN_FREE_HEAP),
+        'components': components,
+    }
+
+
+def check(sizes: Sizes, budget: Dict[str, Any]) -> List[str]:
+    """Return one message per component / region over budget. Empty list means all good."""
+    problems = []
+    limits = budget['components']
+    for name in tracked_components():
+        if name not in sizes:
+            continue
+        if name not in limits:
+            problems.append(f'{name}: no budget recorded (run tools/size_budget.py update)')
+            continue
+        for region in REGIONS:
+            used, limit = sizes[name][region], limits[name].get(region, 0)
+            if used > limit:
+                problems.append(f'{name}: {region} {used} bytes, budget {limit} (+{used - limit})')
+    return problems
+
+
+def print_table(sizes: Sizes, budget: Optional[Dict[str, Any]]) -> None:
+    """One row per tracked component, "used / budget" bytes per region."""
+    limits = (budget or {}).get('components', {})
+    print(f"{'component':<18}" + ''.join(f'{r:>20}' for r in REGIONS))
+    for name in tracked_components():
+        if name not in sizes:
+            continue
+        cells = []
+        for region in REGIONS:
+            limit = limits.get(name, {}).get(region)
+            cells.append(f'{sizes[name][region]}' + (f' / {limit}' if limit is not None else ''))
+        print(f'{name:<18}' + ''.join(f'{c:>20}' for c in cells))
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('action', choices=['check', 'update', 'show'])
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument('--map', help='linker map file, e.g. build/wifi_station.map')
+    source.add_argument('--size-json', help='saved output of idf.py size-components --format json2')
+    parser.add_argument('--budget', default=DEFAULT_BUDGET)
+    parser.add_argument('--headroom', type=float, default=None,
+                        help=f'percent added on top of the current size by update (default {DEFAULT_HEADROOM_PCT})')
+    args = parser.parse_args()
+
+    sizes = load_sizes(args.map, args.size_json)
+    budget = load_budget(args.budget) if os.path.exists(args.budget) else None
+
+    if args.action == 'update':
+        headroom = args.headroom if args.headroom is not None else (budget or {}).get('headroom_pct',
+                                                                                        DEFAULT_HEADROOM_PCT)
+        budget = make_budget(sizes, budget, headroom)
+        with open(args.budget, 'w', encoding='utf-8') as f:
+            json.dump(budget, f, indent=2)
+            f.write('\n')
+        print(f'Wrote {args.budget}')
+
+    print_table(sizes, budget)
+
+    if args.action == 'check':
+        if budget is None:
+            print(f'error: {args.budget} does not exist, create it with "update"', file=sys.stderr)
+            return 1
+        if not budget_recorded(budget):
+            # Nothing to compare against yet; failing here would only say that.
+            print(f'note: {args.budget} has no component budgets yet, record them with "update"')
+            return 0
+        problems = check(sizes, budget)
+        for problem in problems:
+            print(f'over budget: {problem}', file=sys.stderr)
+        return 1 if problems else 0
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())